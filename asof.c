@@ -0,0 +1,228 @@
+#include <stdio.h>	/* printf() */
+#include <stdlib.h>	/* realloc(), qsort(), strtoul() */
+#include <string.h>	/* strcmp() */
+#include <unistd.h>	/* getopt() */
+
+#include "lib/arena.h"
+#include "lib/asof.h"
+#include "lib/plan.h"
+#include "lib/scan.h"
+#include "lib/stats.h"
+#include "lib/store.h"
+
+/*
+ * Usage: asof [-k column] [-w seconds] store typeA typeB
+ *
+ * Aligns two price series, say a mineral and a ship built from it: for
+ * each observation of typeA's best sell price per key (stationid by
+ * default, or regionid, systemid) prints the latest one of typeB's at the
+ * same key, at most seconds (default 86400) older, as
+ * "key rtime priceA priceB ratio" ("-" for a ratio to a zero price).
+ *
+ * The join itself streams (see lib/asof.h), but the series feeding it
+ * don't: partitions are in ingest order, not ASOF_TS order, so each
+ * type's sell orders are collected from every partition it isn't pruned
+ * from and sorted before the join starts. Memory and time grow with the
+ * rows of the two types in the store, not with the whole store; keeping
+ * partitions sorted by ASOF_TS at ingest would let the series stream too.
+*/
+
+#define ASOF_BATCH 4096
+
+struct obs {
+	uint64_t ts;	/* ASOF_TS(key, rtime) */
+	uint64_t price;
+};
+
+struct series {
+	struct obs *o;
+	size_t n;
+	size_t cap;
+};
+
+static int
+cmp_obs(const void *a, const void *b)
+{
+	const struct obs *x = a, *y = b;
+	if (x->ts != y->ts) {
+		return x->ts < y->ts ? -1 : 1;
+	}
+	return (x->price > y->price) - (x->price < y->price);
+}
+
+/* Collects typeID's sell orders from one partition into s. */
+static int
+collect_partition(struct series *s, const struct partition *p,
+    uint32_t typeID, enum eve_col keycol, struct arena *a)
+{
+	const struct query q = { typeID, 0, 0, 0, 0, 0, 0 };
+	struct scan scan;
+	struct scan_batch b;
+	struct stats st;
+	struct plan pl;
+	uint8_t *keep;
+	size_t i;
+	int rc;
+	arena_reset(a);
+	if ((keep = arena_alloc(a, scan_ngroups(p) + 1)) == NULL) {
+		return 1;
+	}
+	plan_partition(&pl, p, stats_load(&st, p, a) ? NULL : &st, &q, keep);
+	if (pl.path == PLAN_PRUNE) {
+		return 0;
+	}
+	if (scan_open(&scan, p, COL_BIT(keycol) | COL_BIT(COL_TYPEID)
+	    | COL_BIT(COL_BID) | COL_BIT(COL_PRICE) | COL_BIT(COL_RTIME),
+	    pl.path == PLAN_SKIP ? keep : NULL, 0, a)) {
+		return 1;
+	}
+	while ((rc = scan_next(&scan, &b)) == 0) {
+		const uint32_t *key = b.col[keycol];
+		const uint32_t *type = b.col[COL_TYPEID];
+		const uint8_t *bid = b.col[COL_BID];
+		const uint64_t *price = b.col[COL_PRICE];
+		const uint32_t *rtime = b.col[COL_RTIME];
+		for (i = 0; i < b.n; ++i) {
+			if (type[i] != typeID || bid[i]) {
+				continue;
+			}
+			if (s->n == s->cap) {
+				struct obs *o;
+				s->cap = s->cap ? 2 * s->cap : 1024;
+				if ((o = realloc(s->o, sizeof(*o) * s->cap))
+				    == NULL) {
+					rc = -1;
+					break;
+				}
+				s->o = o;
+			}
+			s->o[s->n].ts = ASOF_TS(key[i], rtime[i]);
+			s->o[s->n++].price = price[i];
+		}
+	}
+	scan_close(&scan);
+	return rc < 0;
+}
+
+/*
+ * Reads typeID's series from the store: sorted by ASOF_TS, one best (the
+ * lowest) price per key and rtime, split into ts and price columns.
+*/
+static int
+load_series(const struct store *store, uint32_t typeID, enum eve_col keycol,
+    struct arena *a, uint64_t **ts, uint64_t **price, size_t *n)
+{
+	struct series s = { NULL, 0, 0 };
+	unsigned int i;
+	size_t j;
+	for (i = 0; i < store->nparts; ++i) {
+		if (collect_partition(&s, &store->parts[i], typeID, keycol,
+		    a)) {
+			free(s.o);
+			return 1;
+		}
+	}
+	qsort(s.o, s.n, sizeof(*s.o), cmp_obs);
+	*ts = malloc(sizeof(**ts) * (s.n + 1));
+	*price = malloc(sizeof(**price) * (s.n + 1));
+	if (*ts == NULL || *price == NULL) {
+		free(s.o);
+		return 1;
+	}
+	for (*n = j = 0; j < s.n; ++j) {
+		if (*n > 0 && (*ts)[*n - 1] == s.o[j].ts) {
+			continue;
+		}
+		(*ts)[*n] = s.o[j].ts;
+		(*price)[(*n)++] = s.o[j].price;
+	}
+	free(s.o);
+	return 0;
+}
+
+int
+main(int argc, char** argv)
+{
+	enum eve_col keycol = COL_STATIONID;
+	uint32_t tolerance = 86400;
+	uint64_t *lts = NULL, *lval = NULL, *rts = NULL, *rval = NULL;
+	uint64_t out[ASOF_BATCH];
+	uint8_t hit[ASOF_BATCH];
+	size_t ln, rn, l = 0, r = 0, done, used, k;
+	struct asof join;
+	struct store s;
+	struct arena a;
+	int opt, c, rc = 0;
+	while ((opt = getopt(argc, argv, "k:w:")) != -1) {
+		switch(opt) {
+		case 'k':
+			for (c = 0; c < NCOLS; ++c) {
+				if (strcmp(optarg, eve_col_names[c]) == 0) {
+					break;
+				}
+			}
+			if (c != COL_REGIONID && c != COL_SYSTEMID
+			    && c != COL_STATIONID) {
+				goto usage;
+			}
+			keycol = (enum eve_col)c;
+			break;
+		case 'w':
+			tolerance = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (argc - optind != 3) {
+		goto usage;
+	}
+	if (store_open(&s, argv[optind])
+	    || arena_init(&a, 1UL << 20, MEM_SCAN)) {
+		return 1;
+	}
+	if (load_series(&s, (uint32_t)strtoul(argv[optind + 1], NULL, 10),
+	    keycol, &a, &lts, &lval, &ln)
+	    || load_series(&s, (uint32_t)strtoul(argv[optind + 2], NULL, 10),
+	    keycol, &a, &rts, &rval, &rn)) {
+		rc = 1;
+		goto out;
+	}
+	/* Stream both sides through in batches, as a scan would. */
+	asof_init(&join, tolerance);
+	while (l < ln) {
+		const size_t lb = ln - l < ASOF_BATCH ? ln - l : ASOF_BATCH;
+		used = rn - r < ASOF_BATCH ? rn - r : ASOF_BATCH;
+		done = asof_next(&join, lts + l, lb, rts + r, rval + r, &used,
+		    r + used == rn, out, hit);
+		for (k = 0; k < done; ++k) {
+			if (!hit[k]) {
+				continue;
+			}
+			printf("%u %u %.2f %.2f ",
+			    (unsigned int)(lts[l + k] >> 32),
+			    (unsigned int)lts[l + k], lval[l + k] / 100.0,
+			    out[k] / 100.0);
+			if (out[k] == 0) {
+				printf("-\n");
+			} else {
+				printf("%.4f\n", (double)lval[l + k] / out[k]);
+			}
+		}
+		l += done;
+		r += used;
+	}
+out:
+	free(lts);
+	free(lval);
+	free(rts);
+	free(rval);
+	arena_free(&a);
+	store_free(&s);
+	return rc;
+
+usage:
+	printf("Usage: %s [-k regionid|systemid|stationid] [-w seconds] "
+	    "store typeA typeB\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,179 @@
+#include <stdio.h>	/* printf() */
+#include <stdlib.h>	/* malloc(), strtol() */
+#include <pthread.h>	/* pthread_create() */
+#include <time.h>	/* clock_gettime() */
+
+#include "lib/mpmc.h"
+
+/*
+ * Usage: bench_mpmc [items]
+ *
+ * Hands items (default 2M) pointers from producers to consumers, half the
+ * threads each, through lib/mpmc.c and through a mutex + condvar ring of
+ * the same capacity, for 1 to 64 threads. A single thread alternates
+ * push and pop, for the uncontended cost. Prints handoffs per second.
+*/
+
+#define CAP 1024
+
+/* The baseline: what a stage would otherwise use. */
+struct mutexq {
+	pthread_mutex_t lock;
+	pthread_cond_t notfull;
+	pthread_cond_t notempty;
+	void *buf[CAP];
+	size_t head, tail;
+};
+
+static void
+mutexq_push(struct mutexq *q, void *data)
+{
+	pthread_mutex_lock(&q->lock);
+	while (q->head - q->tail == CAP) {
+		pthread_cond_wait(&q->notfull, &q->lock);
+	}
+	q->buf[q->head++ % CAP] = data;
+	pthread_cond_signal(&q->notempty);
+	pthread_mutex_unlock(&q->lock);
+}
+
+static void *
+mutexq_pop(struct mutexq *q)
+{
+	void *data;
+	pthread_mutex_lock(&q->lock);
+	while (q->head == q->tail) {
+		pthread_cond_wait(&q->notempty, &q->lock);
+	}
+	data = q->buf[q->tail++ % CAP];
+	pthread_cond_signal(&q->notfull);
+	pthread_mutex_unlock(&q->lock);
+	return data;
+}
+
+struct run {
+	int lockfree;
+	struct mpmc mq;
+	struct mutexq xq;
+	long per_producer;
+	long per_consumer;
+	unsigned long sum;
+};
+
+static void *
+producer(void *arg)
+{
+	struct run *r = arg;
+	long i;
+	for (i = 1; i <= r->per_producer; ++i) {
+		if (r->lockfree) {
+			mpmc_push(&r->mq, (void *)i);
+		} else {
+			mutexq_push(&r->xq, (void *)i);
+		}
+	}
+	return NULL;
+}
+
+static void *
+consumer(void *arg)
+{
+	struct run *r = arg;
+	unsigned long sum = 0;
+	void *data;
+	long i;
+	for (i = 0; i < r->per_consumer; ++i) {
+		if (r->lockfree) {
+			mpmc_pop(&r->mq, &data);
+		} else {
+			data = mutexq_pop(&r->xq);
+		}
+		sum += (unsigned long)data;
+	}
+	__atomic_add_fetch(&r->sum, sum, __ATOMIC_RELAXED);
+	return NULL;
+}
+
+/* One thread, pushing each item and popping it back. */
+static void *
+alternate(void *arg)
+{
+	struct run *r = arg;
+	unsigned long sum = 0;
+	void *data;
+	long i;
+	for (i = 1; i <= r->per_producer; ++i) {
+		if (r->lockfree) {
+			mpmc_push(&r->mq, (void *)i);
+			mpmc_pop(&r->mq, &data);
+		} else {
+			mutexq_push(&r->xq, (void *)i);
+			data = mutexq_pop(&r->xq);
+		}
+		sum += (unsigned long)data;
+	}
+	r->sum = sum;
+	return NULL;
+}
+
+/* Returns handoffs per second, or -1 if items went missing. */
+static double
+bench(int lockfree, int threads, long items)
+{
+	struct run r;
+	pthread_t tids[64];
+	struct timespec t0, t1;
+	const int producers = (threads > 1) ? threads / 2 : 1;
+	const int consumers = (threads > 1) ? threads - producers : 1;
+	int i;
+	r.lockfree = lockfree;
+	/* Round so producers and consumers move the same number of items. */
+	items -= items % ((long)producers * consumers);
+	r.per_producer = items / producers;
+	r.per_consumer = items / consumers;
+	r.sum = 0;
+	if (mpmc_init(&r.mq, CAP)) {
+		return -1;
+	}
+	pthread_mutex_init(&r.xq.lock, NULL);
+	pthread_cond_init(&r.xq.notfull, NULL);
+	pthread_cond_init(&r.xq.notempty, NULL);
+	r.xq.head = r.xq.tail = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < threads; ++i) {
+		pthread_create(&tids[i], NULL, (threads == 1) ? alternate
+		    : (i < producers) ? producer : consumer, &r);
+	}
+	for (i = 0; i < threads; ++i) {
+		pthread_join(tids[i], NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	mpmc_free(&r.mq);
+	pthread_mutex_destroy(&r.xq.lock);
+	pthread_cond_destroy(&r.xq.notfull);
+	pthread_cond_destroy(&r.xq.notempty);
+	if (r.sum != (unsigned long)producers * (unsigned long)r.per_producer
+	    * (unsigned long)(r.per_producer + 1) / 2) {
+		return -1;
+	}
+	return (double)items / ((double)(t1.tv_sec - t0.tv_sec)
+	    + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9);
+}
+
+int
+main(int argc, char** argv)
+{
+	const long items = (argc > 1) ? strtol(argv[1], NULL, 10) : 2000000;
+	int threads;
+	printf("threads  mpmc Mops/s  mutex Mops/s\n");
+	for (threads = 1; threads <= 64; threads *= 2) {
+		const double lf = bench(1, threads, items);
+		const double mx = bench(0, threads, items);
+		if (lf < 0 || mx < 0) {
+			printf("%7d  lost items\n", threads);
+			return 1;
+		}
+		printf("%7d  %11.2f  %12.2f\n", threads, lf / 1e6, mx / 1e6);
+	}
+	return 0;
+}
@@ -0,0 +1,227 @@
+#include <stdio.h>	/* printf(), tmpfile() */
+#include <stdlib.h>	/* malloc(), strtol(), atoi() */
+#include <stdint.h>	/* uint*_t */
+#include <unistd.h>	/* read(), lseek() */
+#include <time.h>	/* clock_gettime() */
+#include <pthread.h>	/* pthread_create() */
+
+#include "lib/queue.h"
+
+/*
+ * Usage: bench_scan [rows] [threads]
+ *
+ * Filters and sums rows (default 16M) price-like values kept in lz4 queue
+ * pages, written with blocks of 1 to 64 KiB, two ways:
+ *	page	inflates each page whole into a buffer and then filters it,
+ *		the decompress-then-filter scan.
+ *	fused	inflates one block at a time into a reused buffer with
+ *		queue_page_each() and filters it while it's still in L1.
+ * Prices change every 8 rows (noisy), 256 or 8192 rows (runs, which
+ * inflate a page to half a megabyte). threads (default 1) scan at once,
+ * sharing the caches as the workers of a query would. Prints millions of
+ * rows per second for both, after checking that they agree, and how far
+ * the column compressed.
+*/
+
+#define PASSES 8
+
+struct agg {
+	uint64_t lo, hi;	/* Keeps lo <= v < hi. */
+	uint64_t rows;
+	uint64_t sum;
+};
+
+static void
+filter(struct agg *a, const uint64_t *v, size_t n)
+{
+	const uint64_t width = a->hi - a->lo;
+	uint64_t rows = 0, sum = 0;
+	size_t i;
+	for (i = 0; i < n; ++i) { /* Branch free, so it vectorizes. */
+		const uint64_t m = -(uint64_t)(v[i] - a->lo < width);
+		rows += m & 1;
+		sum += v[i] & m;
+	}
+	a->rows += rows;
+	a->sum += sum;
+}
+
+static int
+filter_block(const void *block, unsigned int n, void *arg)
+{
+	filter(arg, block, n);
+	return 0;
+}
+
+static uint64_t
+xorshift(uint64_t *x)
+{
+	*x ^= *x << 13;
+	*x ^= *x >> 7;
+	*x ^= *x << 17;
+	return *x;
+}
+
+/*
+ * Writes rows values in blocks of count into memory, with a new price
+ * every run rows on average. Returns the pages.
+*/
+static char *
+make_pages(long rows, unsigned int count, unsigned int run, size_t *npages)
+{
+	FILE *f = tmpfile();
+	struct queue q;
+	uint64_t x = 88172645463325252ULL, base = 0, v = 0;
+	size_t size;
+	char *pages;
+	long i;
+	if (f == NULL || queue_init(&q, fileno(f), sizeof(v), count)) {
+		return NULL;
+	}
+	for (i = 0; i < rows; ++i) {
+		if (xorshift(&x) % run == 0) {
+			base = xorshift(&x) % 100000 * 100;
+			v = base;
+		} else if (run < 64) { /* Nearby prices. */
+			v = base + xorshift(&x) % 64;
+		}
+		if (queue_push(&q, &v)) {
+			return NULL;
+		}
+	}
+	if (queue_commit(&q)) {
+		return NULL;
+	}
+	queue_free(&q);
+	size = (size_t)lseek(fileno(f), 0, SEEK_END);
+	lseek(fileno(f), 0, SEEK_SET);
+	if ((pages = malloc(size)) == NULL
+	    || read(fileno(f), pages, size) != (ssize_t)size) {
+		return NULL;
+	}
+	fclose(f);
+	*npages = size / PAGESIZE;
+	return pages;
+}
+
+static double
+seconds(const struct timespec *t0, const struct timespec *t1)
+{
+	return (double)(t1->tv_sec - t0->tv_sec)
+	    + (double)(t1->tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+struct run {
+	const char *pages;
+	size_t npages;
+	int fused;
+	int cap;	/* Of the buffer each thread inflates into. */
+	struct agg a;	/* Per thread. */
+};
+
+static void *
+scan(void *arg)
+{
+	struct run *r = arg;
+	struct queue_page pg;
+	char *const buf = malloc((size_t)r->cap);
+	size_t p;
+	int pass, n = 0, use;
+	for (pass = 0; pass < PASSES && buf != NULL && n >= 0; ++pass) {
+		for (p = 0; p < r->npages && n >= 0; ++p) {
+			queue_page_open(&pg, r->pages + p * PAGESIZE,
+			    sizeof(uint64_t));
+			if (r->fused) {
+				n = queue_page_each(&pg, buf, r->cap,
+				    filter_block, &r->a);
+				continue;
+			}
+			for (use = 0; (n = queue_page_next(&pg, buf + use,
+			    r->cap - use)) > 0; use += n);
+			filter(&r->a, (const uint64_t *)buf,
+			    (size_t)use / sizeof(uint64_t));
+		}
+	}
+	if (buf == NULL || n < 0) {
+		r->a.rows = r->a.sum = UINT64_MAX;
+	}
+	free(buf);
+	return NULL;
+}
+
+/*
+ * Runs threads scans of the pages at once. Returns passes per second over
+ * them all, or -1 if any disagrees with want (filled in if it has none).
+*/
+static double
+bench(const char *pages, size_t npages, int fused, int cap, int threads,
+    struct agg *want)
+{
+	struct run r[64];
+	pthread_t tids[64];
+	struct timespec t0, t1;
+	int i;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < threads; ++i) {
+		r[i].pages = pages;
+		r[i].npages = npages;
+		r[i].fused = fused;
+		r[i].cap = cap;
+		r[i].a = *want;
+		r[i].a.rows = r[i].a.sum = 0;
+		pthread_create(&tids[i], NULL, scan, &r[i]);
+	}
+	for (i = 0; i < threads; ++i) {
+		pthread_join(tids[i], NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	for (i = 0; i < threads; ++i) {
+		if (want->rows == 0 && want->sum == 0) {
+			*want = r[i].a;
+		} else if (r[i].a.rows != want->rows
+		    || r[i].a.sum != want->sum) {
+			return -1;
+		}
+	}
+	return (double)threads * PASSES / seconds(&t0, &t1);
+}
+
+int
+main(int argc, char** argv)
+{
+	const long rows = (argc > 1) ? strtol(argv[1], NULL, 10) : 16000000;
+	const int threads = (argc > 2) ? atoi(argv[2]) : 1;
+	unsigned int kb, run;
+	if (rows <= 0 || threads < 1 || threads > 64) {
+		printf("Usage: %s [rows] [threads]\n", argv[0]);
+		return 1;
+	}
+	printf("  run  block KiB  ratio  page Mrows/s  fused Mrows/s\n");
+	for (run = 8; run <= 8192; run *= 32) {
+		for (kb = 1; kb <= 64; kb *= 4) {
+			struct agg a = { 2000000, 6000000, 0, 0 };
+			size_t npages;
+			char *pages = make_pages(rows, kb * 1024
+			    / sizeof(uint64_t), run, &npages);
+			double pr, fr;
+			if (pages == NULL) {
+				printf("Failed to write pages.\n");
+				return 1;
+			}
+			pr = bench(pages, npages, 0, QUEUE_PAGEMAX
+			    * (int)sizeof(uint64_t), threads, &a);
+			fr = bench(pages, npages, 1, (int)kb * 1024, threads,
+			    &a);
+			if (pr < 0 || fr < 0) {
+				printf("Scans disagree.\n");
+				return 1;
+			}
+			printf("%5u  %9u  %5.2f  %12.1f  %13.1f\n", run, kb,
+			    (double)rows * sizeof(uint64_t)
+			    / (double)(npages * PAGESIZE),
+			    pr * (double)rows / 1e6, fr * (double)rows / 1e6);
+			free(pages);
+		}
+	}
+	return 0;
+}
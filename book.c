@@ -0,0 +1,87 @@
+#include <stdio.h>	/* printf() */
+#include <stdlib.h>	/* strtoul() */
+#include <unistd.h>	/* getopt(), close() */
+#include <time.h>	/* clock_gettime() */
+
+#include "lib/market.h"
+#include "lib/net.h"
+
+/*
+ * Usage: book [-d depth] [-n count] addr typeID stationID
+ *
+ * Asks marketd on addr for the book of typeID at stationID, and prints
+ * its best depth (default 5) bids and asks: price, remaining and minimum
+ * volume, and orderID. With -n, asks count times over the connection and
+ * prints the query rate instead, to load test a daemon.
+*/
+
+static void
+print_side(const char *side, const struct market_order *o, uint32_t n)
+{
+	uint32_t i;
+	for (i = 0; i < n; ++i) {
+		printf("%s %llu.%02llu %u %u %llu\n", side,
+		    (unsigned long long)(o[i].price / 100),
+		    (unsigned long long)(o[i].price % 100), o[i].volRem,
+		    o[i].volMin, (unsigned long long)o[i].orderID);
+	}
+}
+
+int
+main(int argc, char** argv)
+{
+	struct market_query q = { 0, 0, 5, 0 };
+	struct market_reply reply;
+	struct timespec t0, t1;
+	unsigned long count = 0, i;
+	int opt, fd;
+	while ((opt = getopt(argc, argv, "d:n:")) != -1) {
+		switch(opt) {
+		case 'd':
+			q.depth = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			count = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			argc = 0;
+			break;
+		}
+	}
+	if (argc - optind != 3) {
+		printf("Usage: %s [-d depth] [-n count] addr typeID "
+		    "stationID\n", argv[0]);
+		return 1;
+	}
+	q.typeID = (uint32_t)strtoul(argv[optind + 1], NULL, 10);
+	q.stationID = (uint32_t)strtoul(argv[optind + 2], NULL, 10);
+	if ((fd = net_connect(argv[optind])) == -1) {
+		return 1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < (count ? count : 1); ++i) {
+		if (net_write(fd, &q, sizeof(q))
+		    || net_read(fd, &reply, sizeof(reply))) {
+			printf("Lost the connection to %s\n", argv[optind]);
+			close(fd);
+			return 1;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	close(fd);
+	if (reply.rc) {
+		printf("No book yet.\n");
+		return 1;
+	}
+	if (count) {
+		const double secs = (double)(t1.tv_sec - t0.tv_sec)
+		    + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+		printf("%lu queries in %.3f s, %.0f/s\n", count, secs,
+		    (double)count / secs);
+		return 0;
+	}
+	printf("%s %u %u\n", reply.date, q.typeID, q.stationID);
+	print_side("bid", reply.bids, reply.nbids);
+	print_side("ask", reply.asks, reply.nasks);
+	return 0;
+}
@@ -1,30 +1,111 @@
+#define _GNU_SOURCE	/* cpu_set_t for lib/topo.h */
 #include <stdio.h>	/* printf() */
 #include <errno.h>	/* perror() */
 #include <unistd.h>	/* close(), fork() */
 #include <sys/wait.h>	/* waitpid() */
+#include <sys/stat.h>	/* mkdir() */
 #include <string.h>	/* strcpy() strcat() */
 #include <fcntl.h>	/* O_WRONLY */
+#include <stdlib.h>	/* getenv() */
+#include <signal.h>	/* signal() */
+#include <pthread.h>	/* pthread_create() */
 
+#include "lib/arena.h"
+#include "lib/checksum.h"
+#include "lib/cpu.h"
 #include "lib/eve_parser.h"
 #include "lib/eve_txn.h"
+#include "lib/mem.h"
+#include "lib/pool.h"
+#include "lib/shard.h"
+#include "lib/stats.h"
+#include "lib/topo.h"
+#include "lib/tz.h"
+#include "lib/zframes.h"
+
+/*
+ * Where parsed txns go: batches of rows, split by typeID over one pipe per
+ * column writer. With a single writer there's no split. Rows of a dump in
+ * local time are converted to UTC a batch at a time on the way out.
+*/
+struct sink {
+	#define BATCHSIZE 4096
+	int fds[SHARD_MAX];
+	unsigned int nshards;
+	size_t use;
+	struct eve_txn *batch;
+	struct eve_txn *scattered;
+	uint8_t *ids;
+	const struct tz_zone *zone;	/* Of the dump, NULL if UTC. */
+	uint32_t *times;		/* 2 * BATCHSIZE, for the zone. */
+};
+
+static int
+write_all(int fd, const void *buf, size_t len)
+{
+	ssize_t wb;
+	while (len > 0) {
+		if ((wb = write(fd, buf, len)) == -1) {
+			perror("write()");
+			return 1;
+		}
+		buf = (const char *)buf + wb;
+		len -= (size_t)wb;
+	}
+	return 0;
+}
+
+/* The lines are gone by the time a batch is converted to UTC. */
+static void
+bad_time(const struct eve_txn *txn)
+{
+	printf("Bad time (%u, %u) : order %llu\n", txn->issued, txn->rtime,
+	    (unsigned long long)txn->orderID);
+}
+
+static int
+sink_flush(struct sink *s)
+{
+	size_t offsets[SHARD_MAX + 1];
+	unsigned int i;
+	int rc = 0;
+	if (s->zone != NULL) {
+		s->use = eve_txn_to_utc(s->batch, s->use, s->zone, s->times,
+		    bad_time);
+	}
+	if (s->nshards == 1) {
+		rc = write_all(s->fds[0], s->batch, s->use * sizeof(*s->batch));
+		s->use = 0;
+		return rc;
+	}
+	shard_scatter(s->batch, s->use, s->nshards, s->scattered, offsets,
+	    s->ids);
+	for (i = 0; i < s->nshards && !rc; ++i) {
+		rc = write_all(s->fds[i], s->scattered + offsets[i],
+		    (offsets[i + 1] - offsets[i]) * sizeof(*s->batch));
+	}
+	s->use = 0;
+	return rc;
+}
 
 /*
  * Parses the given line and writes appropriate error messages.
  * Convienence function which makes the eve_parser code look better.
+ * Returns 0 if txn holds a good record.
 */
-static void
-parse_errhandler(const char* line, int outfd, const eve_txn_parser txn_parse)
+static int
+parse_errhandler(const char* line, struct eve_txn *txn,
+    const eve_txn_parser txn_parse)
 {
-	struct eve_txn txn;
-	switch(txn_parse(line, &txn)) {
+	switch(txn_parse(line, txn)) {
 	case 0:
-		write(outfd, &txn, sizeof(txn));
-		return;
+		return 0;
 	case 1:
-		printf("Bad time (%u, %u) : %s\n", txn.issued,txn.rtime,line);
+		printf("Bad time (%u, %u) : %s\n", txn->issued, txn->rtime,
+		    line);
 		break;
 	case 2:
-		printf("Bad bid %u : %s", txn.bid, line);
+		printf("Bad bid %u : %s", txn->bid, line);
 		break;
 	case 3:
 		printf("Bad range : %s", line);
@@ -33,18 +114,24 @@ parse_errhandler(const char* line, int outfd, const eve_txn_parser txn_parse)
 		printf("Bad input : %s", line);
 		break;
 	}
-	return;
+	return 1;
 }
 
 /*
- * Parses txns from the infd.
+ * Parses txns from the infd into out. Per-dump buffers come from scratch,
+ * which must outlive fin.
 */
 static int
-eve_parser(const int infd, const int outfd)
+eve_parser(const int infd, struct sink *out, struct arena *scratch)
 {
+	#define INBUFSIZE (4UL << 20)
 	FILE *fin = fdopen(infd, "r");
+	char *inbuf = arena_alloc(scratch, INBUFSIZE);
 	char datestr[12];
 	eve_txn_parser parse_txn;
+	if (inbuf != NULL) {
+		setvbuf(fin, inbuf, _IOFBF, INBUFSIZE);
+	}
 	{ /* Parse file date. YYYY-MM-DD header format */
 		unsigned int year, mon, day;
 		fgets(datestr, 12, fin);
@@ -53,19 +140,27 @@ eve_parser(const int infd, const int outfd)
 		    + (datestr[3] - '0'));
 		mon = (unsigned int)((datestr[5] -'0')*10 + (datestr[6] -'0'));
 		day = (unsigned int)((datestr[8] -'0')*10 + (datestr[9] -'0'));
-		if (year < 2006 || year > 2020 || mon < 1 || mon > 12
+		if (year < 2006 || year >= tz_endyear || mon < 1 || mon > 12
 		    || day < 1 || day > 31) {
 			printf("Bad date: year: %u month: %u day: %u\n",
 			    year, mon, day);
 			return 1;
 		}
-		parse_txn = init_eve_txn_parser(year, mon, day);
+		parse_txn = init_eve_txn_parser_local(year, mon, day,
+		    &out->zone);
 	}
 	{ /* Parse transactions. */
 		char linebuf[500];
 		fgets(linebuf, 500, fin); /* Get rid of header line. */
 		while (fgets(linebuf, 500, fin)) {
-			parse_errhandler(linebuf, outfd, parse_txn);
+			if (parse_errhandler(linebuf, &out->batch[out->use],
+			    parse_txn) == 0 && ++out->use == BATCHSIZE
+			    && sink_flush(out)) {
+				return 1;
+			}
+		}
+		if (sink_flush(out)) {
+			return 1;
 		}
 	}
 	{ /* Error handling and reporting */
@@ -109,26 +204,24 @@ sample_output(int infd)
 }
 
 static int
-sample_column_output(int infd)
+sample_column_output(int infd, const char* const prefix)
 {
 	ssize_t rb;
 	struct eve_txn txn;
-	FILE* fouts[15];
+	FILE* fouts[NCOLS];
 	{ /* Initialize fouts */
-		const char* const prefix = "./data/";
-		const char* const names[15] = { "orderid", "regionid",
-			"systemid", "stationid", "typeid", "bid", "price",
-			"volmin", "volrem", "volent", "issued", "duration",
-			"range", "reportedby", "reportedtime"
-		};
 		char buf[256];
-		for (rb = 0; rb < 15; ++rb) {
+		if (strlen(prefix) + 16 > sizeof(buf)) {
+			printf("Output directory too long: %s\n", prefix);
+			return 1;
+		}
+		for (rb = 0; rb < NCOLS; ++rb) {
 			strcpy(buf, prefix);
-			strcat(buf, names[rb]);
+			strcat(buf, eve_col_names[rb]);
 			fouts[rb] = fopen(buf, "wb");
 			if (!fouts[rb]) {
 				printf("Failed to open %s with error: %s\n",
-				    names[rb], strerror(errno));
+				    eve_col_names[rb], strerror(errno));
 				for (; rb > 0; rb--) { fclose(fouts[rb - 1]); }
 				return 1;
 			}
@@ -157,39 +250,242 @@ sample_column_output(int infd)
 		perror("read()");
 		return 1;
 	}
-	for (rb = 0; rb < 15; ++rb) {
+	for (rb = 0; rb < NCOLS; ++rb) {
 		fclose(fouts[rb]);
 	}
 	return 0;
 }
 
-int
-main(void)
+/*
+ * A repacked dump (see repack.c), inflated in parallel on the pool and fed
+ * to the parser through a pipe, in file order, by a helper thread.
+*/
+struct zsource {
+	struct zframes z;
+	struct pool *pool;
+	int fd;
+	int pipe[2];
+	pthread_t tid;
+	int rc;
+};
+
+static void *
+zsource_run(void *arg)
 {
-	int rc, pipes[2];
-	pid_t childpid;
-	if (pipe(pipes)) {
+	struct zsource *s = arg;
+	s->rc = zframes_cat(&s->z, s->fd, s->pipe[1], s->pool);
+	close(s->pipe[1]); /* EOF for the parser. */
+	return NULL;
+}
+
+static int
+zsource_open(struct zsource *s, const char *path, struct pool *pool)
+{
+	s->pool = pool;
+	if ((s->fd = open(path, O_RDONLY)) == -1) {
+		printf("Failed to open %s with error: %s\n",
+		    path, strerror(errno));
+		return 1;
+	}
+	if (zframes_open(&s->z, s->fd)) {
+		printf("Not a seekable zstd archive: %s\n", path);
+		goto fail_open;
+	}
+	if (pipe(s->pipe)) {
 		printf("Failed to make a pipe.\n");
 		goto fail_pipe;
 	}
-	switch(childpid = fork()) {
-	case -1:
-		printf("Failed to fork().\n");
-		goto fail_fork;
-	case 0: /* child */
-		close(pipes[1]);
-		return sample_column_output(pipes[0]);
-	default: /* parent */
-		close(pipes[0]);
-		rc = eve_parser(STDIN_FILENO, pipes[1]); /* parse stdin */
-		close(pipes[1]);
-		waitpid(childpid, NULL, 0);
-		return rc;
+	/* A parser that gives up early makes our writes fail, not kill us. */
+	signal(SIGPIPE, SIG_IGN);
+	if (pthread_create(&s->tid, NULL, zsource_run, s)) {
+		printf("Failed to start the inflate thread.\n");
+		goto fail_thread;
 	}
+	return 0;
 
-fail_fork:
-	close(pipes[0]);
-	close(pipes[1]);
+fail_thread:
+	close(s->pipe[0]);
+	close(s->pipe[1]);
 fail_pipe:
+	zframes_free(&s->z);
+fail_open:
+	close(s->fd);
 	return 1;
 }
+
+static int
+zsource_close(struct zsource *s)
+{
+	close(s->pipe[0]);
+	pthread_join(s->tid, NULL);
+	zframes_free(&s->z);
+	close(s->fd);
+	return s->rc;
+}
+
+/*
+ * Forks one column writer per shard, each reading its own pipe and
+ * writing into outdir (outdir/shardN/ when sharded). Fills in s->fds.
+ * Returns the number of writers started, which is s->nshards on success.
+*/
+static unsigned int
+start_writers(struct sink *s, const char *outdir, const struct topo *topo,
+    pid_t *pids)
+{
+	int pipes[SHARD_MAX][2];
+	unsigned int i, j;
+	for (i = 0; i < s->nshards; ++i) {
+		if (pipe(pipes[i])) {
+			printf("Failed to make a pipe.\n");
+			break;
+		}
+	}
+	if (i < s->nshards) {
+		for (j = 0; j < i; ++j) {
+			close(pipes[j][0]);
+			close(pipes[j][1]);
+		}
+		return 0;
+	}
+	for (i = 0; i < s->nshards; ++i) {
+		switch(pids[i] = fork()) {
+		case -1:
+			printf("Failed to fork().\n");
+			for (j = i; j < s->nshards; ++j) {
+				close(pipes[j][0]);
+				close(pipes[j][1]);
+			}
+			return i;
+		case 0: { /* child */
+			char dir[256];
+			int rc;
+			/* Keep only our read end, or writers never see EOF. */
+			for (j = 0; j < s->nshards; ++j) {
+				close(pipes[j][1]);
+				if (j != i) {
+					close(pipes[j][0]);
+				}
+			}
+			for (j = 0; j < i; ++j) {
+				close(s->fds[j]);
+			}
+			if (s->nshards == 1) {
+				snprintf(dir, sizeof(dir), "%s", outdir);
+			} else {
+				snprintf(dir, sizeof(dir), "%sshard%u/",
+				    outdir, i);
+				mkdir(dir, 0755);
+			}
+			if (topo_pin(topo, getenv("EVE_PIN_WRITER"))) {
+				_exit(1);
+			}
+			rc = sample_column_output(pipes[i][0], dir);
+			if (rc == 0) { /* For the query planner. */
+				rc = stats_collect(dir);
+			}
+			if (rc == 0) { /* For scrubs and EVE_VERIFY. */
+				rc = checksum_collect(dir);
+			}
+			topo_report(topo, "writer");
+			mem_tag_report("writer");
+			fflush(stdout);
+			_exit(rc);
+		}
+		default: /* parent */
+			close(pipes[i][0]);
+			s->fds[i] = pipes[i][1];
+			break;
+		}
+	}
+	return s->nshards;
+}
+
+/*
+ * Usage: converter [outdir/ [dump.zst]]
+ * Reads a dump from stdin (date header line first) and writes its columns
+ * into outdir, "./data/" by default. The trailing '/' is required. Given
+ * a repacked dump, reads that instead of stdin.
+ * EVE_PIN_PARSER and EVE_PIN_WRITER pin the two stages ("node:N" or a CPU
+ * list, see lib/topo.h) before they allocate their buffers.
+ * EVE_SHARDS=K splits rows by typeID hash over K writers, each owning
+ * outdir/shardN/ (see lib/shard.h); queries for one typeID then read just
+ * one of them. EVE_THREADS sizes the thread pool.
+*/
+int
+main(int argc, char** argv)
+{
+	int rc = 0, status;
+	unsigned int i, started;
+	pid_t pids[SHARD_MAX];
+	struct topo topo;
+	struct arena scratch;
+	struct zsource zsrc;
+	struct sink sink;
+	struct pool pool;
+	int infd = STDIN_FILENO;
+	const char* const outdir = (argc > 1) ? argv[1] : "./data/";
+	const char* const shards = getenv("EVE_SHARDS");
+	sink.nshards = shards ? (unsigned int)atoi(shards) : 1;
+	sink.use = 0;
+	sink.zone = NULL;
+	if (sink.nshards < 1 || sink.nshards > SHARD_MAX) {
+		printf("EVE_SHARDS must be 1 to %d\n", SHARD_MAX);
+		return 1;
+	}
+	topo_init(&topo);
+	printf("CPU level: %s\n", cpu_level_name(cpu_init()));
+	fflush(stdout); /* Don't let the child inherit the buffered output. */
+	if ((started = start_writers(&sink, outdir, &topo, pids))
+	    < sink.nshards) {
+		rc = 1;
+		goto wait;
+	}
+	/* Pin first, so the scratch arena is allocated node-local. */
+	if (topo_pin(&topo, getenv("EVE_PIN_PARSER"))
+	    || arena_init(&scratch, 2 * INBUFSIZE, MEM_PARSER)) {
+		rc = 1;
+		goto wait;
+	}
+	if (pool_init(&pool, 0)) { /* Workers inherit the parser's pinning. */
+		rc = 1;
+		goto wait;
+	}
+	sink.batch = arena_alloc(&scratch, BATCHSIZE * sizeof(*sink.batch));
+	sink.scattered = arena_alloc(&scratch,
+	    BATCHSIZE * sizeof(*sink.scattered));
+	sink.ids = arena_alloc(&scratch, BATCHSIZE);
+	sink.times = arena_alloc(&scratch, 2 * BATCHSIZE * sizeof(uint32_t));
+	if (sink.batch == NULL || sink.scattered == NULL || sink.ids == NULL
+	    || sink.times == NULL) {
+		rc = 1;
+	} else if (argc > 2 && zsource_open(&zsrc, argv[2], &pool)) {
+		rc = 1;
+	} else {
+		if (argc > 2) {
+			infd = zsrc.pipe[0];
+		}
+		rc = eve_parser(infd, &sink, &scratch);
+		if (argc > 2 && zsource_close(&zsrc)) {
+			printf("Failed to inflate %s\n", argv[2]);
+			rc = 1;
+		}
+		topo_report(&topo, "parser");
+		mem_huge_report("parser");
+		mem_tag_report("parser");
+		arena_report(&scratch, "parser");
+	}
+	pool_free(&pool);
+
+wait:
+	for (i = 0; i < started; ++i) {
+		close(sink.fds[i]);
+	}
+	/* The caller only publishes output if every process worked. */
+	for (i = 0; i < started; ++i) {
+		if (waitpid(pids[i], &status, 0) == -1 || !WIFEXITED(status)
+		    || WEXITSTATUS(status) != 0) {
+			rc = 1;
+		}
+	}
+	return rc;
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>	/* printf() */
+#include <stdlib.h>	/* strtoul() */
+#include <unistd.h>	/* getopt(), close() */
+
+#include "lib/net.h"
+#include "lib/query.h"
+
+/*
+ * Usage: coord [-t typeID] [-r regionID] [-b 0|1] [-f from] [-u to]
+ *		[-k topk] [-e] shard...
+ *
+ * Scatter-gather over shard servers (see shardd.c). The filters and the
+ * aggregation are pushed down: each shard scans only its own part of the
+ * history and returns a partial aggregate, and the coordinator merges
+ * them. Shards work concurrently; we send every request before reading
+ * any reply. The result shows the planners' row estimate next to the
+ * real count; with -e every shard also logs its per-partition plans.
+*/
+
+int
+main(int argc, char** argv)
+{
+	struct query q = { 0, 0, 0, 0, -1, 0, 0 };
+	struct query_reply reply;
+	struct partial total;
+	int opt, i, n, rc = 0;
+	int fds[64];
+	while ((opt = getopt(argc, argv, "t:r:b:f:u:k:e")) != -1) {
+		switch(opt) {
+		case 't':
+			q.typeID = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			q.regionID = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			q.bid = atoi(optarg);
+			break;
+		case 'f':
+			q.from = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'u':
+			q.to = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'k':
+			q.topk = (uint32_t)strtoul(optarg, NULL, 10);
+			q.topk = q.topk > QUERY_TOPK ? QUERY_TOPK : q.topk;
+			break;
+		case 'e':
+			q.flags |= QUERY_EXPLAIN;
+			break;
+		default:
+			printf("Usage: %s [-t typeID] [-r regionID] [-b 0|1] "
+			    "[-f from] [-u to] [-k topk] [-e] shard...\n",
+			    argv[0]);
+			return 1;
+		}
+	}
+	n = argc - optind;
+	if (n < 1 || n > 64) {
+		printf("Need 1 to 64 shard addresses.\n");
+		return 1;
+	}
+	for (i = 0; i < n; ++i) { /* Scatter. */
+		fds[i] = net_connect(argv[optind + i]);
+		if (fds[i] != -1 && net_write(fds[i], &q, sizeof(q))) {
+			close(fds[i]);
+			fds[i] = -1;
+		}
+	}
+	partial_init(&total);
+	for (i = 0; i < n; ++i) { /* Gather. */
+		if (fds[i] == -1 || net_read(fds[i], &reply, sizeof(reply))
+		    || reply.rc != 0) {
+			printf("Shard %s failed.\n", argv[optind + i]);
+			rc = 1;
+		} else {
+			printf("shard %s rows %llu\n", argv[optind + i],
+			    (unsigned long long)reply.result.rows);
+			partial_merge(&total, &reply.result, &q);
+		}
+		if (fds[i] != -1) {
+			close(fds[i]);
+		}
+	}
+	partial_print(&total);
+	return rc;
+}
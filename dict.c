@@ -0,0 +1,127 @@
+#include <stdio.h>	/* printf(), snprintf() */
+#include <sys/stat.h>	/* stat() */
+
+#include "lib/arena.h"
+#include "lib/dict.h"
+#include "lib/store.h"
+
+/*
+ * Usage:
+ *	dict store
+ *		Writes the dense ID columns (see lib/dict.h) of every
+ *		partition in the store that lacks them.
+ *	dict store segment/
+ *		Writes those of an unpublished segment, as dumper.sh does
+ *		before moving it into the store.
+ * Either way the store's dictionaries get the new IDs. Runs hold the
+ * store's dictionary lock from loading the dictionaries to saving them,
+ * so a backfill alongside dumper.sh can't hand out IDs the other loses.
+*/
+
+static const enum eve_col cols[] = {
+	COL_REGIONID, COL_SYSTEMID, COL_STATIONID
+};
+#define NDICTS (sizeof(cols) / sizeof(cols[0]))
+
+/* Whether p's dense column for d is missing or out of date. */
+static int
+stale(const struct dict *d, const struct partition *p)
+{
+	const enum eve_col dense = dict_dense_col(d->col);
+	char path[STORE_PATHLEN];
+	struct stat st;
+	store_colpath(p, dense, path);
+	return stat(path, &st) != 0
+	    || (uint64_t)st.st_size != p->rows * eve_col_sizes[dense];
+}
+
+static int
+encode(struct dict *dicts, const struct partition *p, struct arena *a)
+{
+	unsigned int i;
+	for (i = 0; i < NDICTS; ++i) {
+		if (!stale(&dicts[i], p)) {
+			continue;
+		}
+		arena_reset(a);
+		if (dict_encode(&dicts[i], p, a)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Encodes a segment directory, plain or sharded. */
+static int
+encode_segment(struct dict *dicts, const char *dir, struct arena *a)
+{
+	struct partition p;
+	char shard[STORE_PATHLEN];
+	unsigned int i;
+	if (partition_init(&p, dir, "") == 0) {
+		return encode(dicts, &p, a);
+	}
+	for (i = 0;; ++i) {
+		snprintf(shard, sizeof(shard), "%sshard%u/", dir, i);
+		if (partition_init(&p, shard, "")) {
+			break;
+		}
+		if (encode(dicts, &p, a)) {
+			return 1;
+		}
+	}
+	if (i == 0) {
+		printf("No columns in %s\n", dir);
+		return 1;
+	}
+	return 0;
+}
+
+int
+main(int argc, char** argv)
+{
+	struct dict dicts[NDICTS];
+	struct store s;
+	struct arena a;
+	unsigned int i, loaded = 0;
+	int rc = 0, lock;
+	if (argc != 2 && argc != 3) {
+		printf("Usage: %s store [segment/]\n", argv[0]);
+		return 1;
+	}
+	if ((lock = dict_lock(argv[1])) == -1) {
+		return 1;
+	}
+	if (arena_init(&a, 1UL << 20, MEM_INDEX)) {
+		dict_unlock(lock);
+		return 1;
+	}
+	for (; loaded < NDICTS; ++loaded) {
+		if (dict_load(&dicts[loaded], argv[1], cols[loaded])) {
+			rc = 1;
+			goto out;
+		}
+	}
+	if (argc == 3) {
+		rc = encode_segment(dicts, argv[2], &a);
+	} else if (store_open(&s, argv[1]) == 0) {
+		for (i = 0; i < s.nparts && rc == 0; ++i) {
+			rc = encode(dicts, &s.parts[i], &a);
+		}
+		store_free(&s);
+	} else {
+		rc = 1;
+	}
+	/* Even after a failure; any IDs handed out may be in use already. */
+	for (i = 0; i < NDICTS; ++i) {
+		rc |= dict_save(&dicts[i], argv[1]);
+		printf("%s: %u IDs\n", eve_col_names[cols[i]], dicts[i].n);
+	}
+out:
+	for (i = 0; i < loaded; ++i) {
+		dict_free(&dicts[i]);
+	}
+	arena_free(&a);
+	dict_unlock(lock);
+	return rc;
+}
@@ -1,5 +1,20 @@
 #!/bin/sh
 
+# Usage:
+#	dumper.sh		Ingest every dump currently in ${dumps}.
+#	dumper.sh -w		Ingest those, then keep watching ${dumps} and
+#				ingest each new dump as soon as it is complete.
+#
+# Every dump is converted into a new version directory ${store}/${date}.v*/
+# and then published by renaming a symlink ${store}/${date} to it over the
+# old one, so readers never see a half written segment, nor a moment
+# without the date when a re-sent dump replaces it. Its date is appended to
+# ${store}/MANIFEST once the rename is done, unless it's listed already;
+# the manifest is what queries should use to find the published segments.
+
+dumps=${DUMPS:-~/Downloads/dumps/new/}
+store=${STORE:-./data}
+
 #mkfifo ./lol.pipe
 
 # Performance testing pipes.
@@ -12,23 +27,128 @@
 # open the pipe for writing
 #exec 3>./lol.pipe
 
-# For use with the external hard drive.
-#for item in $( find -E /Volumes/Backup/2* -type f -regex '.*\.dump\.gz' )
-# For updating
-for item in $( find -E ~/Downloads/dumps/new/ -type f -regex '.*\.dump\.gz' )
-do
+# Point ${store}/${date} at the version directory $2 and list the date in
+# the manifest. Deciding that from the manifest rather than the link also
+# repairs a publish that died between the two.
+publish()
+{
+	date=$1
+	ver=$2
+	link=${store}/${date}
+
+	# Directories from before versioning can't be renamed over; this
+	# leaves the date missing for a moment, once.
+	if [ -d ${link} ] && [ ! -L ${link} ]; then
+		mv ${link} ${link}.v0 || return 1
+		ln -s ${date}.v0 ${link} || return 1
+	fi
+	ln -s ${ver##*/} ${link}.lnk && mv -T ${link}.lnk ${link} || return 1
+	grep -qx ${date} ${store}/MANIFEST 2>/dev/null ||
+	    echo ${date} >> ${store}/MANIFEST || return 1
+	# Older versions, and any a failed publish left behind.
+	for old in ${link}.v*
+	do
+		[ ${old} = ${ver} ] || rm -rf ${old}
+	done
+}
+
+# Convert a single dump and publish it in the manifest.
+ingest()
+{
+	item=$1
 	date=$( echo $item | rev | cut -c 9-18 | rev )
-	size=$( gzip -l ${item} | sed '1d' | awk '{print $2}' )
+
+	# Inflate in parallel once the dump has a gzindex sidecar.
+	if [ ${item}.gzi -nt ${item} ]; then
+		unzip="./gzindex cat"
+	else
+		unzip="gunzip -c"
+	fi
+	# A repacked archive (see repack.c) is faster still, and the converter
+	# reads it natively:
+	#	( echo ${date}; gunzip -c ${item} ) | ./repack ${item%.gz}.zst
+	zst=${item%.gz}.zst
 
 	echo "Processing - ${date}"
+	tmp=$( mktemp -d ${store}/${date}.vXXXXXX ) && chmod 755 ${tmp} ||
+	    return 1
 	# Pipe mode stuff (Currently broken).
 	#( echo ${date}; gunzip -c ${item} ) >&3
 	# Regular mode (faster).
-#	( echo ${date}; gunzip -c ${item} ) | ./test >> ./log.txt
+	if [ ${zst} -nt ${item} ]; then
+		./test ${tmp}/ ${zst} >> ./log.txt
+	else
+		( echo ${date}; ${unzip} ${item} ) | ./test ${tmp}/ >> ./log.txt
+	fi
+	if [ $? -ne 0 ]
+	then
+		echo "Failed - ${date}"
+		rm -rf ${tmp}
+		return 1
+	fi
 	# Testing.
 	#( echo ${date}; gunzip -c ${item} ) | valgrind ./test
 
-done
+	# Dense location IDs (see lib/dict.h), before anyone can see the
+	# segment.
+	if ! ./dict ${store} ${tmp}/ >> ./log.txt
+	then
+		echo "Failed - ${date}"
+		rm -rf ${tmp}
+		return 1
+	fi
+
+	# Publish. A re-sent dump replaces the old segment but keeps its
+	# manifest entry.
+	if ! publish ${date} ${tmp}
+	then
+		echo "Failed - ${date}"
+		return 1
+	fi
+	echo "Published - ${date}"
+
+	# Index after publishing, so it doesn't delay the data. Re-ingests of
+	# this dump pay nothing for the index and get parallel inflate.
+	if [ ! ${item}.gzi -nt ${item} ]; then
+		./gzindex build ${item} >> ./log.txt
+	fi
+}
+
+# Ingest the dumps already there.
+# For use with the external hard drive.
+#for item in $( find -E /Volumes/Backup/2* -type f -regex '.*\.dump\.gz' )
+scan()
+{
+	for item in $( find ${dumps} -type f -name '*.dump.gz' )
+	do
+		ingest ${item}
+	done
+}
+
+mkdir -p ${store}
+
+# Watch mode. inotify reports a dump once the downloader has closed it
+# (close_write) or moved it into place (moved_to), so nothing partial is read.
+# The scan waits until the watches are established, so a dump landing in
+# between is seen by one or the other; one seen by both is ingested once.
+if [ "$1" = "-w" ]; then
+	inotifywait -m -e close_write -e moved_to --format '%w%f' \
+	    ${dumps} 2>&1 |
+	while read item
+	do
+		case ${item} in
+		"Watches established.")
+			scan
+			;;
+		*.dump.gz)
+			date=$( echo ${item} | rev | cut -c 9-18 | rev )
+			[ ${store}/${date} -nt ${item} ] || ingest ${item}
+			;;
+		esac
+	done
+else
+	scan
+fi
 
 # Close pipe.
 exec 3>&-
@@ -0,0 +1,894 @@
+#include <stdio.h>	/* printf(), tmpfile() */
+#include <stdlib.h>	/* malloc(), strtoull(), abort() */
+#include <string.h>	/* memcmp(), memset(), strstr() */
+#include <stdarg.h>	/* va_list */
+#include <unistd.h>	/* read(), lseek(), dup() */
+#include <zlib.h>	/* gzdopen() */
+
+#include "lib/cpu.h"
+#include "lib/eve_parser.h"
+#include "lib/queue.h"
+#include "lib/zframes.h"
+#include "lib/gzindex.h"
+#include "lib/dict.h"
+#include "lib/pool.h"
+#include "lib/tz.h"
+
+/*
+ * Usage: fuzz [-n runs] [-s seed] [input...]
+ *
+ * Differential fuzzing of the parsers and codecs. Every input is a stream
+ * of choices: its first byte picks a target, the rest drive a generator.
+ *
+ *	parser	Generates a dump line in one of the formats of formats.txt,
+ *		for a file date in one of the parser eras, and hands it to
+ *		the scalar parser (init_eve_txn_parser()) and to every path
+ *		in paths[]. The struct eve_txn outputs and reject codes must
+ *		match bit for bit. Up to BATCHMAX lines also go through the
+ *		converter's path, local times converted a batch at a time
+ *		(eve_txn_to_utc()), which must agree but for reporting a bad
+ *		field rather than a bad time when a line has both.
+ *	queue	Round-trips a column through lz4 queue pages, then makes sure
+ *		a corrupted page fails its checksum, and is rejected rather
+ *		than read out of bounds.
+ *	zframes	Round-trips a column through a seekable zstd archive.
+ *	gzindex	Gzips a column, indexes it and extracts random ranges.
+ *	dict	Adds random sparse IDs to a dictionary and saves and loads it.
+ *	tz	Converts times near a zone's transitions to UTC a block at a
+ *		time, and one at a time.
+ *
+ * The lines stay inside the grammar of formats.txt, since the parsers
+ * trust it (see eve_parser.c): no fast path is expected to agree with the
+ * scalar one on input the scalar one would read out of bounds.
+ *
+ * Without arguments, runs (default 100k) random inputs from seed; with
+ * them, replays the given inputs, e.g. crash files. A mismatch prints
+ * both sides, saves the input to ./fuzz-crash and aborts.
+ *
+ * Built with -DFUZZ_LIBFUZZER -fsanitize=fuzzer, main() is left out and
+ * libFuzzer drives LLVMFuzzerTestOneInput() instead.
+*/
+
+#define LINEMAX 500		/* The converter's line buffer. */
+#define COLMAX (1 << 17)	/* Elements in a generated column. */
+
+/* The fuzzer's input, read as a stream of choices. */
+struct src {
+	const uint8_t *p;
+	size_t n;
+};
+
+/* Returns a choice in [0, bound), 0 once the input runs out. */
+static uint32_t
+take(struct src *s, uint32_t bound)
+{
+	uint32_t v = 0;
+	uint32_t range;
+	{ /* Preconditions */
+		assert(s != NULL);
+		assert(bound > 0);
+	}
+	for (range = 1; range < bound && s->n > 0; range <<= 8) {
+		v = v << 8 | *s->p++;
+		s->n--;
+		if (range > UINT32_MAX >> 8) {
+			break;
+		}
+	}
+	return v % bound;
+}
+
+static const uint8_t *crash;
+static size_t crashLen;
+
+/* Saves the input being run and aborts, so libFuzzer keeps it too. */
+static void
+fail(const char *target, const char *why)
+{
+	FILE *f;
+	printf("%s: %s\n", target, why);
+	if (crash != NULL && (f = fopen("fuzz-crash", "wb")) != NULL) {
+		fwrite(crash, 1, crashLen, f);
+		fclose(f);
+		printf("Input saved to fuzz-crash\n");
+	}
+	fflush(stdout);
+	abort();
+}
+
+/* Parsers */
+
+/*
+ * The model: a slow, independent reading of formats.txt, which keeps the
+ * scalar parser honest until fast paths exist to check against it.
+ *
+ * The scalar calendar (ejday()) applies March based month lengths to
+ * January based months, and counts a leap year's extra day from its
+ * January, so it runs up to two days ahead of UTC and puts December 31st
+ * and January 1st on the same day. Every stored column was written with
+ * it, so that calendar is the contract; model_days() spells it out.
+*/
+static uint32_t
+model_days(uint32_t year, uint32_t month, uint32_t day)
+{
+	static const uint32_t before[13] = {
+		0, 31, 61, 92, 122, 153, 184, 214, 245, 275, 306, 337, 367
+	};
+	const uint32_t leaps = year / 4 - year / 100 + year / 400;
+	return year * 365 + leaps + before[month] + day - 1 - 719558;
+}
+
+/* Day of the month of the nth Sunday (5 for the last), by the real calendar. */
+static uint32_t
+model_sunday(uint32_t year, uint32_t month, uint32_t n)
+{
+	static const uint32_t t[12] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+	const uint32_t y = year - (month < 3);
+	const uint32_t dow = (y + y / 4 - y / 100 + y / 400 + t[month - 1] + 1)
+	    % 7; /* Of the 1st, 0 is Sunday. */
+	const uint32_t first = 1 + (7 - dow) % 7;
+	if (n == 5) {
+		return (first + 28 <= 31) ? first + 28 : first + 21;
+	}
+	return first + 7 * (n - 1);
+}
+
+/*
+ * Pacific time by the US rules, independently of tzdata: daylight saving
+ * from the first Sunday of April to the last of October until 2006, then
+ * from the second Sunday of March to the first of November, switching at
+ * 2:00 (so local 3:00 and 1:00 after). Covers the years of lib/tztab.c.
+*/
+static uint32_t
+model_utc(uint32_t pt)
+{
+	uint32_t y, start, end;
+	for (y = 2003; y <= 2036; ++y) {
+		if (y < 2007) {
+			start = model_days(y, 4, model_sunday(y, 4, 1));
+			end = model_days(y, 10, model_sunday(y, 10, 5));
+		} else {
+			start = model_days(y, 3, model_sunday(y, 3, 2));
+			end = model_days(y, 11, model_sunday(y, 11, 1));
+		}
+		if (pt >= start * 86400 + 3 * 3600
+		    && pt < end * 86400 + 1 * 3600) {
+			return pt + 7 * 3600;
+		}
+	}
+	return pt + 8 * 3600;
+}
+
+static uint32_t
+model_datetime(const char *f)
+{
+	unsigned int y, mo, d, h, mi, s;
+	const char *frac;
+	uint32_t t;
+	if (sscanf(f, "%4u-%2u-%2u %2u:%2u:%2u", &y, &mo, &d, &h, &mi, &s)
+	    != 6 || mo > 12) {
+		fail("parser", "model can't read a generated datetime");
+	}
+	t = model_days(y, mo, d) * 86400 + h * 3600 + mi * 60 + s;
+	if ((frac = strchr(f, '.')) != NULL && frac[1] >= '5') {
+		t++; /* Rounded by the first decimal. */
+	}
+	return t;
+}
+
+static int8_t
+model_range(const char *f)
+{
+	if (f[0] == '-') {
+		return -1;
+	}
+	switch ((unsigned int)strtoull(f, NULL, 10)) {
+	case 0: return 0;
+	case 5: return 5;
+	case 10: return 10;
+	case 20: return 20;
+	case 40: return 40;
+	case 32767: return 127;
+	case 65535: return 127;
+	default: return -2;
+	}
+}
+
+static uint32_t modelDate; /* Of the file, from model_init(). */
+
+static int
+model_parse(const char *line, struct eve_txn *txn)
+{
+	#define NFIELDS 15
+	char f[NFIELDS][64];
+	const int quoted = line[0] == '"';
+	const char *sep = quoted ? "\",\"" : " , ";
+	const char *p = line + quoted, *q;
+	int i;
+	for (i = 0; i < NFIELDS; ++i) {
+		q = (i < NFIELDS - 1) ? strstr(p, sep) : p + strcspn(p, "\"\n");
+		if (q == NULL || q - p >= (long)sizeof(f[i])) {
+			fail("parser", "model can't split a generated line");
+		}
+		memcpy(f[i], p, (size_t)(q - p));
+		f[i][q - p] = '\0';
+		p = q + 3;
+	}
+	memset(txn, 0, sizeof(*txn));
+	txn->orderID = strtoull(f[0], NULL, 10);
+	txn->regionID = (uint32_t)strtoull(f[1], NULL, 10);
+	if (f[2][0] == '-') { /* What the scalar parser gives up on. */
+		txn->bid = 20;
+	} else {
+		const char *cents = strchr(f[6], '.');
+		txn->systemID = (uint32_t)strtoull(f[2], NULL, 10);
+		txn->stationID = (uint32_t)strtoull(f[3], NULL, 10);
+		txn->typeID = (uint32_t)strtoull(f[4], NULL, 10);
+		txn->bid = (uint8_t)strtoull(f[5], NULL, 10);
+		txn->price = strtoull(f[6], NULL, 10) * 100;
+		if (cents != NULL) {
+			txn->price += (uint64_t)(cents[1] - '0') * 10;
+			if (cents[2] != '\0') {
+				txn->price += (uint64_t)(cents[2] - '0');
+			}
+		}
+		txn->volMin = (uint32_t)strtoull(f[7], NULL, 10);
+		txn->volRem = (uint32_t)strtoull(f[8], NULL, 10);
+		txn->volEnt = (uint32_t)strtoull(f[9], NULL, 10);
+		txn->issued = model_datetime(f[10]);
+		txn->duration = (uint16_t)strtoull(f[11], NULL, 10);
+		txn->range = model_range(f[12]);
+		txn->reportedby = strtoull(f[13], NULL, 10);
+		txn->rtime = model_datetime(f[14]);
+	}
+	/* Eras of formats.txt. */
+	if (modelDate < model_days(2007, 10, 1) * 86400) {
+		txn->issued = model_utc(txn->issued);
+		txn->rtime = model_utc(txn->rtime);
+	}
+	if (modelDate < model_days(2007, 1, 1) * 86400) {
+		txn->range = (int8_t)(-1 * txn->bid); /* Always station. */
+	}
+	if (txn->issued > txn->rtime) {
+		return 1;
+	} else if (txn->bid > 1) {
+		return 2;
+	} else if (txn->range == -2) {
+		return 3;
+	}
+	return 0;
+}
+
+static eve_txn_parser
+model_init(uint32_t year, uint32_t month, uint32_t day)
+{
+	modelDate = model_days(year, month, day) * 86400;
+	return model_parse;
+}
+
+/*
+ * Paths checked against the scalar parser. A fast parser goes live only
+ * once it has an entry here and survives a fuzzing run.
+*/
+static const struct path {
+	const char *name;
+	eve_txn_parser (*init)(uint32_t year, uint32_t month, uint32_t day);
+} paths[] = {
+	{ "model", model_init },
+};
+#define NPATHS (sizeof(paths) / sizeof(paths[0]))
+
+struct line {
+	char buf[LINEMAX];
+	size_t use;
+};
+
+static void
+put(struct line *l, const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	l->use += (size_t)vsnprintf(l->buf + l->use, LINEMAX - l->use, fmt,
+	    ap);
+	va_end(ap);
+	assert(l->use < LINEMAX);
+}
+
+/* Between 1 and max digits, leading zeros and all. */
+static void
+put_digits(struct line *l, struct src *s, uint32_t max)
+{
+	uint32_t n = 1 + take(s, max);
+	while (n-- > 0) {
+		put(l, "%c", '0' + take(s, 10));
+	}
+}
+
+/*
+ * Minutes and seconds. One choice per call, so an input means the same
+ * line whatever order a compiler evaluates arguments in.
+*/
+static void
+put_clock(struct line *l, struct src *s)
+{
+	put(l, ":%02u", take(s, 60));
+	put(l, ":%02u", take(s, 60));
+}
+
+/* A datetime, often right on a daylight saving switch or new year. */
+static void
+put_datetime(struct line *l, struct src *s)
+{
+	static const uint32_t edges[][3] = {
+		{ 2006, 4, 2 }, { 2006, 10, 29 }, { 2007, 3, 11 },
+		{ 2007, 11, 4 }, { 2006, 12, 31 }, { 2007, 1, 1 },
+		{ 2011, 12, 31 }
+	};
+	const uint32_t *e = edges[take(s, sizeof(edges) / sizeof(edges[0]))];
+	if (take(s, 2)) {
+		put(l, "%04u-%02u-%02u", e[0], e[1], e[2]);
+		put(l, " %02u", take(s, 5));
+	} else {
+		put(l, "%04u", 2005 + take(s, 8));
+		put(l, "-%02u", 1 + take(s, 12));
+		put(l, "-%02u", 1 + take(s, 31));
+		put(l, " %02u", take(s, 24));
+	}
+	put_clock(l, s);
+	if (take(s, 2)) { /* Not all timestamps have decimal seconds. */
+		put(l, ".");
+		put_digits(l, s, 6);
+	}
+}
+
+/*
+ * Writes a line for a file of the date in *ymd, with every field drawn
+ * from s: quoting, both duration styles, optional cents and decimal
+ * seconds, every range, and the bad values the parsers reject.
+*/
+static void
+gen_line(struct line *l, struct src *s, uint32_t ymd[3])
+{
+	static const char *const ranges[] = {
+		"-1", "0", "5", "10", "20", "40", "32767", "65535"
+	};
+	const int quoted = (int)take(s, 2);
+	const char *sep = quoted ? "\",\"" : " , ";
+	switch (take(s, 3)) { /* Era of the file. */
+	case 0:
+		ymd[0] = 2006;
+		ymd[1] = 1 + take(s, 12);
+		break;
+	case 1:
+		ymd[0] = 2007;
+		ymd[1] = 1 + take(s, 9);
+		break;
+	default:
+		ymd[0] = 2007 + take(s, 6);
+		ymd[1] = ymd[0] == 2007 ? 10 + take(s, 3) : 1 + take(s, 12);
+		break;
+	}
+	ymd[2] = 1 + take(s, 28);
+	memset(l, 0, sizeof(*l));
+	put(l, "%s", quoted ? "\"" : "");
+	put_digits(l, s, 19);			/* orderid */
+	put(l, "%s", sep);
+	put_digits(l, s, 10);			/* regionid */
+	put(l, "%s%s", sep, take(s, 32) ? "" : "-");
+	put_digits(l, s, 10);			/* systemid */
+	put(l, "%s", sep);
+	put_digits(l, s, 10);			/* stationid */
+	put(l, "%s", sep);
+	put_digits(l, s, 10);			/* typeid */
+	put(l, "%s", sep);
+	put(l, "%u%s", take(s, 8) ? take(s, 2) : take(s, 10), sep); /* bid */
+	put_digits(l, s, 12);			/* price */
+	if (take(s, 4)) {
+		put(l, ".");
+		put_digits(l, s, 2);
+	}
+	put(l, "%s", sep);
+	put_digits(l, s, 10);			/* volmin */
+	put(l, "%s", sep);
+	put_digits(l, s, 10);			/* volrem */
+	put(l, "%s", sep);
+	put_digits(l, s, 10);			/* volent */
+	put(l, "%s", sep);
+	put_datetime(l, s);			/* issued */
+	put(l, "%s", sep);
+	put_digits(l, s, 5);			/* duration */
+	if (take(s, 3) == 0) {
+		put(l, ":");
+	} else {
+		put(l, " %s, ", take(s, 2) ? "days" : "day");
+	}
+	put(l, "%u", take(s, 10)); /* A single digit hour, see parse_duration */
+	put_clock(l, s);
+	if (take(s, 4) == 0) {
+		put(l, ".");
+		put_digits(l, s, 6);
+	}
+	put(l, "%s", sep);
+	if (take(s, 4)) {			/* range */
+		put(l, "%s", ranges[take(s, 8)]);
+	} else {
+		put(l, "%s", take(s, 2) ? "-" : "");
+		put_digits(l, s, 5);
+	}
+	put(l, "%s", sep);
+	put_digits(l, s, 19);			/* reportedby */
+	put(l, "%s", sep);
+	put_datetime(l, s);			/* rtime */
+	put(l, "%s\n", quoted ? "\"" : "");
+}
+
+/* Lines per parser input, converted to UTC as one batch. */
+#define BATCHMAX 8
+
+static void
+fuzz_parser(struct src *s)
+{
+	struct line l;
+	struct eve_txn want[BATCHMAX], got, batch[BATCHMAX];
+	int wantRc[BATCHMAX], gotRc;
+	uint32_t ymd[3], times[2 * BATCHMAX];
+	const struct tz_zone *zone, *batchZone = NULL;
+	size_t i, j, m, kept, nbatch = 0;
+	const size_t n = 1 + take(s, BATCHMAX);
+	for (j = 0; j < n; ++j) {
+		gen_line(&l, s, ymd);
+		memset(&want[j], 0xa5, sizeof(want[j]));
+		wantRc[j] = init_eve_txn_parser(ymd[0], ymd[1], ymd[2])(l.buf,
+		    &want[j]);
+		for (i = 0; i < NPATHS; ++i) {
+			memset(&got, 0x5a, sizeof(got));
+			gotRc = paths[i].init(ymd[0], ymd[1], ymd[2])(l.buf,
+			    &got);
+			if (gotRc != wantRc[j]
+			    || memcmp(&got, &want[j], sizeof(got))) {
+				printf("File date %04u-%02u-%02u, line: %s",
+				    ymd[0], ymd[1], ymd[2], l.buf);
+				printf("scalar (%d):\n", wantRc[j]);
+				print_eve_txn(&want[j]);
+				printf("%s (%d):\n", paths[i].name, gotRc);
+				print_eve_txn(&got);
+				fail("parser", paths[i].name);
+			}
+		}
+		/*
+		 * The converter's path: local times, checked a batch at a
+		 * time. A line with a bad time and a bad field may report
+		 * the field instead.
+		*/
+		memset(&got, 0x5a, sizeof(got));
+		gotRc = init_eve_txn_parser_local(ymd[0], ymd[1], ymd[2],
+		    &zone)(l.buf, &got);
+		if (zone == NULL) {
+			if (gotRc != wantRc[j]
+			    || memcmp(&got, &want[j], sizeof(got))) {
+				printf("line: %s", l.buf);
+				fail("parser", "local parser in UTC");
+			}
+		} else if (gotRc != 0) {
+			if (gotRc != wantRc[j] && wantRc[j] != 1) {
+				printf("line: %s", l.buf);
+				fail("parser", "local parser reject");
+			}
+		} else if (wantRc[j] > 1) {
+			printf("line: %s", l.buf);
+			fail("parser", "local parser accepted a bad field");
+		} else {
+			if (batchZone != NULL && batchZone != zone) {
+				fail("parser", "local zones disagree");
+			}
+			batchZone = zone;
+			want[nbatch] = want[j];
+			wantRc[nbatch] = wantRc[j];
+			batch[nbatch++] = got;
+		}
+	}
+	if (nbatch == 0) {
+		return;
+	}
+	kept = eve_txn_to_utc(batch, nbatch, batchZone, times, NULL);
+	for (i = m = 0; i < nbatch; ++i) {
+		if (wantRc[i] != 0) {
+			continue;
+		}
+		if (m >= kept || memcmp(&batch[m], &want[i], sizeof(got))) {
+			printf("scalar:\n");
+			print_eve_txn(&want[i]);
+			if (m < kept) {
+				printf("batch:\n");
+				print_eve_txn(&batch[m]);
+			}
+			fail("parser", "eve_txn_to_utc()");
+		}
+		m++;
+	}
+	if (m != kept) {
+		fail("parser", "eve_txn_to_utc() kept a bad time");
+	}
+}
+
+/* Codecs */
+
+static uint64_t
+xorshift(uint64_t *x)
+{
+	*x ^= *x << 13;
+	*x ^= *x >> 7;
+	*x ^= *x << 17;
+	return *x;
+}
+
+/*
+ * A column of n elements of one of the stored widths, shaped like real
+ * ones: noise, runs, sorted IDs, or a few distinct values. Returns its
+ * size in bytes.
+*/
+static size_t
+gen_column(struct src *s, char *col, unsigned int *eleSize, size_t *n)
+{
+	uint64_t x = 0x9e3779b97f4a7c15ULL ^ take(s, UINT32_MAX);
+	const uint32_t shape = take(s, 4);
+	uint64_t v = 0;
+	size_t i;
+	*eleSize = eve_col_sizes[take(s, NALLCOLS)];
+	*n = take(s, COLMAX + 1);
+	for (i = 0; i < *n; ++i) {
+		switch (shape) {
+		case 0:
+			v = xorshift(&x);
+			break;
+		case 1:
+			v = (xorshift(&x) % 64 == 0) ? xorshift(&x) : v;
+			break;
+		case 2:
+			v += xorshift(&x) % 16;
+			break;
+		default:
+			v = xorshift(&x) % 8 * 1000003;
+			break;
+		}
+		/* Little endian hosts keep the low, varying bytes. */
+		memcpy(col + i * *eleSize, &v, *eleSize);
+	}
+	return *n * *eleSize;
+}
+
+/* Reads all of fd from the start into buf, of cap bytes. */
+static size_t
+slurp(int fd, char *buf, size_t cap)
+{
+	size_t use = 0;
+	ssize_t rb;
+	lseek(fd, 0, SEEK_SET);
+	while (use < cap && (rb = read(fd, buf + use, cap - use)) > 0) {
+		use += (size_t)rb;
+	}
+	return use;
+}
+
+static char col[COLMAX * 8];
+static char back[COLMAX * 8 + PAGESIZE];
+
+static void
+fuzz_queue(struct src *s)
+{
+	struct queue q;
+	struct queue_page pg;
+	unsigned int eleSize;
+	size_t n, i, use = 0, pages;
+	const size_t bytes = gen_column(s, col, &eleSize, &n);
+	const unsigned int bufCount = 1 + take(s, 4096);
+	char *const block = malloc((size_t)bufCount * eleSize);
+	char *const page = malloc(PAGESIZE);
+	FILE *f = tmpfile();
+	int rc;
+	if (block == NULL || page == NULL || f == NULL
+	    || queue_init(&q, fileno(f), eleSize, bufCount)) {
+		fail("queue", "out of memory");
+	}
+	for (i = 0; i < n; ++i) {
+		if (queue_push(&q, col + i * eleSize)) {
+			fail("queue", "queue_push() failed");
+		}
+	}
+	if (queue_commit(&q)) {
+		fail("queue", "queue_commit() failed");
+	}
+	queue_free(&q);
+	lseek(fileno(f), 0, SEEK_SET);
+	for (pages = 0; read(fileno(f), page, PAGESIZE) == PAGESIZE; ++pages) {
+		if (queue_page_check(page)) {
+			fail("queue", "queue_page_check() rejected a page");
+		}
+		queue_page_open(&pg, page, eleSize);
+		while ((rc = queue_page_next(&pg, block,
+		    (int)(bufCount * eleSize))) > 0) {
+			if (use + (size_t)rc > bytes
+			    || memcmp(col + use, block, (size_t)rc)) {
+				fail("queue", "pages differ from the column");
+			}
+			use += (size_t)rc;
+		}
+		if (rc < 0) {
+			fail("queue", "queue_page_next() rejected a page");
+		}
+	}
+	if (use != bytes) {
+		fail("queue", "pages are short of the column");
+	}
+	if (pages > 0) { /* A flipped bit must not make us read wild. */
+		lseek(fileno(f), (off_t)take(s, (uint32_t)pages) * PAGESIZE,
+		    SEEK_SET);
+		if (read(fileno(f), page, PAGESIZE) != PAGESIZE) {
+			fail("queue", "page vanished");
+		}
+		page[take(s, PAGESIZE)] ^= (char)(1 << take(s, 8));
+		if (queue_page_check(page) == 0) {
+			fail("queue", "a flipped bit passed the check");
+		}
+		queue_page_open(&pg, page, eleSize);
+		while (queue_page_next(&pg, block,
+		    (int)(bufCount * eleSize)) > 0) {
+			continue;
+		}
+	}
+	fclose(f);
+	free(page);
+	free(block);
+}
+
+static struct pool pool;
+static int poolUp;
+
+static void
+fuzz_zframes(struct src *s)
+{
+	struct zframes_writer w;
+	struct zframes z;
+	unsigned int eleSize;
+	size_t n, off, len;
+	const size_t bytes = gen_column(s, col, &eleSize, &n);
+	FILE *f = tmpfile(), *out = tmpfile();
+	if (f == NULL || out == NULL) {
+		fail("zframes", "can't make temporary files");
+	}
+	if (!poolUp && pool_init(&pool, 2) == 0) {
+		poolUp = 1;
+	}
+	zframes_writer_init(&w, f, 1 + (int)take(s, 3));
+	for (off = 0; off < bytes; off += len) { /* Frames of any size. */
+		len = 1 + take(s, 1 << 18);
+		len = len < bytes - off ? len : bytes - off;
+		if (zframes_write(&w, col + off, len)) {
+			fail("zframes", "zframes_write() failed");
+		}
+	}
+	if (zframes_writer_finish(&w) || fflush(f)) {
+		fail("zframes", "zframes_writer_finish() failed");
+	}
+	if (zframes_open(&z, fileno(f))) {
+		fail("zframes", "zframes_open() rejected its own archive");
+	}
+	if (zframes_cat(&z, fileno(f), fileno(out), &pool)) {
+		fail("zframes", "zframes_cat() failed");
+	}
+	if (slurp(fileno(out), back, sizeof(back)) != bytes
+	    || memcmp(col, back, bytes)) {
+		fail("zframes", "archive differs from the column");
+	}
+	zframes_free(&z);
+	fclose(out);
+	fclose(f);
+}
+
+static void
+fuzz_gzindex(struct src *s)
+{
+	struct gzindex idx;
+	unsigned int eleSize;
+	size_t n;
+	ssize_t rb;
+	const size_t bytes = gen_column(s, col, &eleSize, &n);
+	const off_t span = (off_t)(16384 + take(s, 1 << 18));
+	FILE *f = tmpfile();
+	gzFile gz;
+	uint32_t i;
+	if (f == NULL || (gz = gzdopen(dup(fileno(f)), "wb")) == NULL) {
+		fail("gzindex", "can't make a temporary file");
+	}
+	if ((bytes > 0 && gzwrite(gz, col, (unsigned int)bytes) == 0)
+	    || gzclose(gz) != Z_OK) {
+		fail("gzindex", "can't gzip the column");
+	}
+	if (gzindex_build(fileno(f), span, &idx)) {
+		fail("gzindex", "gzindex_build() failed");
+	}
+	if (idx.length != (int64_t)bytes) {
+		fail("gzindex", "index has the wrong length");
+	}
+	for (i = 0; i < 8; ++i) {
+		const size_t off = take(s, (uint32_t)bytes + 1);
+		const size_t len = take(s, 1 << 17);
+		const size_t want = len < bytes - off ? len : bytes - off;
+		rb = gzindex_extract(fileno(f), &idx, (off_t)off,
+		    (unsigned char *)back, len);
+		if (rb != (ssize_t)want || memcmp(col + off, back, want)) {
+			fail("gzindex", "extract differs from the column");
+		}
+	}
+	gzindex_free(&idx);
+	fclose(f);
+}
+
+static char dictRoot[] = "/tmp/eve-fuzz-XXXXXX";
+static int dictUp;
+
+static void
+fuzz_dict(struct src *s)
+{
+	static const enum eve_col cols[] = {
+		COL_REGIONID, COL_SYSTEMID, COL_STATIONID
+	};
+	const enum eve_col c = cols[take(s, 3)];
+	const uint32_t universe = 1 + take(s, UINT32_MAX - 1);
+	const uint32_t n = take(s, COLMAX);
+	uint64_t x = 0x9e3779b97f4a7c15ULL ^ take(s, UINT32_MAX);
+	uint32_t *dense = (uint32_t *)col;
+	uint32_t *sparse = (uint32_t *)back;
+	struct dict d, l;
+	uint32_t i, seen = 0;
+	char path[STORE_PATHLEN];
+	if (!dictUp && mkdtemp(dictRoot) == NULL) {
+		fail("dict", "can't make a temporary store");
+	}
+	dictUp = 1;
+	snprintf(path, sizeof(path), "%s/DICT.%s", dictRoot, eve_col_names[c]);
+	unlink(path);
+	if (dict_load(&d, dictRoot, c)) {
+		fail("dict", "dict_load() failed on an empty store");
+	}
+	for (i = 0; i < n; ++i) {
+		sparse[i] = (uint32_t)(xorshift(&x) % universe);
+		if ((dense[i] = dict_add(&d, sparse[i])) == DICT_NONE) {
+			fail("dict", "dict_add() failed");
+		}
+		if (dense[i] > seen || d.ids[dense[i]] != sparse[i]) {
+			fail("dict", "dense IDs aren't in first seen order");
+		}
+		seen += dense[i] == seen;
+	}
+	if (dict_save(&d, dictRoot) || dict_load(&l, dictRoot, c)) {
+		fail("dict", "can't save and load the dictionary");
+	}
+	if (l.n != d.n || memcmp(l.ids, d.ids, sizeof(*d.ids) * d.n)) {
+		fail("dict", "loaded dictionary differs");
+	}
+	for (i = 0; i < n; ++i) {
+		if (dict_lookup(&l, sparse[i]) != dense[i]) {
+			fail("dict", "loaded dictionary maps IDs differently");
+		}
+	}
+	dict_free(&l);
+	dict_free(&d);
+	unlink(path);
+}
+
+/* Times, mostly within a few hours of a transition of the zone. */
+static void
+fuzz_tz(struct src *s)
+{
+	const struct tz_zone *z = &tz_zones[take(s, tz_nzones)];
+	uint32_t t[3 * TZ_BLOCK], want[3 * TZ_BLOCK];
+	const size_t n = take(s, 3 * TZ_BLOCK);
+	uint64_t x = 0x9e3779b97f4a7c15ULL ^ take(s, UINT32_MAX), r;
+	size_t i;
+	for (i = 0; i < n; ++i) {
+		r = xorshift(&x);
+		if (r % 8) {
+			t[i] = z->at[(r >> 8) % z->n] - 4 * 3600
+			    + (uint32_t)(r >> 32) % (8 * 3600);
+		} else {
+			t[i] = (uint32_t)(r >> 32);
+		}
+		want[i] = tz_to_utc(z, t[i]);
+	}
+	tz_to_utc_batch(z, t, n);
+	for (i = 0; i < n; ++i) {
+		if (t[i] != want[i]) {
+			printf("%s: %u, not %u\n", z->name, t[i], want[i]);
+			fail("tz", "tz_to_utc_batch()");
+		}
+	}
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	static void (*const targets[])(struct src *s) = {
+		fuzz_parser, fuzz_queue, fuzz_zframes, fuzz_gzindex, fuzz_dict,
+		fuzz_tz
+	};
+	struct src s;
+	s.p = data;
+	s.n = size;
+	crash = data;
+	crashLen = size;
+	/* Mostly lines: they're cheap and where the fast paths will be. */
+	switch (take(&s, 16)) {
+	case 0:
+		targets[1 + take(&s, 5)](&s);
+		break;
+	default:
+		targets[0](&s);
+		break;
+	}
+	return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+/* Replays one input from a file. */
+static int
+replay(const char *name)
+{
+	static uint8_t buf[1 << 16];
+	FILE *f = fopen(name, "rb");
+	size_t n;
+	if (f == NULL) {
+		perror(name);
+		return 1;
+	}
+	n = fread(buf, 1, sizeof(buf), f);
+	fclose(f);
+	LLVMFuzzerTestOneInput(buf, n);
+	printf("%s: ok\n", name);
+	return 0;
+}
+
+int
+main(int argc, char** argv)
+{
+	uint8_t input[256];
+	uint64_t x = 1, runs = 100000, r;
+	int opt, rc = 0;
+	size_t i;
+	while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = strtoull(optarg, NULL, 10);
+			break;
+		case 's':
+			x = strtoull(optarg, NULL, 10) | 1;
+			break;
+		default:
+			printf("Usage: %s [-n runs] [-s seed] [input...]\n",
+			    argv[0]);
+			return 1;
+		}
+	}
+	cpu_init(); /* EVE_CPU=scalar fuzzes the portable kernels. */
+	if (optind < argc) {
+		for (; optind < argc; ++optind) {
+			rc |= replay(argv[optind]);
+		}
+		return rc;
+	}
+	for (r = 0; r < runs; ++r) {
+		for (i = 0; i < sizeof(input); ++i) {
+			input[i] = (uint8_t)xorshift(&x);
+		}
+		LLVMFuzzerTestOneInput(input, sizeof(input));
+	}
+	printf("%llu runs, %u parser paths: ok\n", (unsigned long long)runs,
+	    (unsigned int)NPATHS);
+	if (dictUp) {
+		rmdir(dictRoot);
+	}
+	return 0;
+}
+#endif
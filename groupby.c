@@ -0,0 +1,226 @@
+#include <stdio.h>	/* printf(), fprintf() */
+#include <stdlib.h>	/* strtoul(), calloc() */
+#include <string.h>	/* strcmp() */
+#include <unistd.h>	/* getopt() */
+#include <sys/stat.h>	/* stat() */
+
+#include "lib/arena.h"
+#include "lib/dict.h"
+#include "lib/hashagg.h"
+#include "lib/scan.h"
+#include "lib/store.h"
+
+/*
+ * Usage: groupby [-m budgetMB] store column
+ *
+ * Prints "key rows volume" for every value of column (orderid, reportedby,
+ * typeid, ...) over the whole store, volume being the sum of volRem, in no
+ * particular order. Aggregation stays within budgetMB (default 256) of
+ * memory by spilling to disk, see lib/hashagg.h; how much it spilled goes
+ * to stderr. Location columns with dense IDs (see lib/dict.h) are grouped
+ * in a flat array instead.
+*/
+
+struct group {
+	uint64_t rows;
+	uint64_t volume;
+};
+
+static void
+merge(void *dst, const void *src)
+{
+	struct group *d = dst;
+	const struct group *s = src;
+	d->rows += s->rows;
+	d->volume += s->volume;
+	return;
+}
+
+static void
+emit(uint64_t key, const void *val, void *arg)
+{
+	const struct group *g = val;
+	(void)arg;
+	printf("%llu %llu %llu\n", (unsigned long long)key,
+	    (unsigned long long)g->rows, (unsigned long long)g->volume);
+	return;
+}
+
+/* Feeds one partition's rows to h. */
+static int
+add_partition(struct hashagg *h, const struct partition *p,
+    enum eve_col col, struct arena *a)
+{
+	struct scan scan;
+	struct scan_batch b;
+	struct group g;
+	size_t i;
+	int rc, err = 0;
+	if (scan_open(&scan, p, COL_BIT(col) | COL_BIT(COL_VOLREM), NULL, 0,
+	    a)) {
+		return 1;
+	}
+	g.rows = 1;
+	while (!err && (rc = scan_next(&scan, &b)) == 0) {
+		const uint32_t *volRem = b.col[COL_VOLREM];
+		for (i = 0; i < b.n && !err; ++i) {
+			uint64_t key;
+			switch (eve_col_sizes[col]) {
+			case 8:
+				key = ((const uint64_t *)b.col[col])[i];
+				break;
+			case 4:
+				key = ((const uint32_t *)b.col[col])[i];
+				break;
+			case 2:
+				key = ((const uint16_t *)b.col[col])[i];
+				break;
+			default:
+				key = ((const uint8_t *)b.col[col])[i];
+				break;
+			}
+			g.volume = volRem[i];
+			err = hashagg_add(h, key, &g);
+		}
+	}
+	scan_close(&scan);
+	return err || rc < 0;
+}
+
+/*
+ * Groups by col's dense IDs in a flat array. Returns -1 if some partition
+ * has none, else 0 on success.
+*/
+static int
+dense_groupby(const struct store *s, enum eve_col col, struct arena *a)
+{
+	const enum eve_col dense = dict_dense_col(col);
+	char path[STORE_PATHLEN];
+	struct group *groups;
+	struct scan scan;
+	struct scan_batch b;
+	struct stat st;
+	struct dict d;
+	unsigned int i;
+	uint32_t k;
+	size_t j;
+	int rc = 0;
+	if (dense == NALLCOLS) {
+		return -1;
+	}
+	for (i = 0; i < s->nparts; ++i) {
+		store_colpath(&s->parts[i], dense, path);
+		if (stat(path, &st) || (uint64_t)st.st_size
+		    != s->parts[i].rows * eve_col_sizes[dense]) {
+			return -1;
+		}
+	}
+	if (dict_load(&d, s->root, col)) {
+		return -1;
+	}
+	if ((groups = calloc(d.n + 1, sizeof(*groups))) == NULL) {
+		dict_free(&d);
+		return 1;
+	}
+	for (i = 0; i < s->nparts && rc == 0; ++i) {
+		arena_reset(a);
+		if (scan_open(&scan, &s->parts[i], COL_BIT(dense)
+		    | COL_BIT(COL_VOLREM), NULL, 0, a)) {
+			rc = 1;
+			break;
+		}
+		while (rc == 0 && (rc = scan_next(&scan, &b)) == 0) {
+			const uint32_t *id = b.col[dense];
+			const uint32_t *volRem = b.col[COL_VOLREM];
+			for (j = 0; j < b.n; ++j) {
+				/* Out of range lands in the spare slot. */
+				const uint32_t g = id[j] < d.n ? id[j] : d.n;
+				groups[g].rows++;
+				groups[g].volume += volRem[j];
+			}
+		}
+		scan_close(&scan);
+		rc = rc < 0 || groups[d.n].rows != 0;
+	}
+	if (rc == 0) {
+		for (k = 0; k < d.n; ++k) {
+			if (groups[k].rows) {
+				emit(d.ids[k], &groups[k], NULL);
+			}
+		}
+		fprintf(stderr, "groupby: %u dense IDs\n", d.n);
+	} else if (groups[d.n].rows) {
+		printf("Dense IDs past the %s dictionary.\n",
+		    eve_col_names[col]);
+	}
+	free(groups);
+	dict_free(&d);
+	return rc;
+}
+
+int
+main(int argc, char** argv)
+{
+	size_t budget = 256UL << 20;
+	struct hashagg h;
+	struct store s;
+	struct arena a;
+	unsigned int i;
+	int opt, col, rc = 0;
+	while ((opt = getopt(argc, argv, "m:")) != -1) {
+		switch(opt) {
+		case 'm':
+			budget = strtoul(optarg, NULL, 10) << 20;
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (argc - optind != 2) {
+		goto usage;
+	}
+	for (col = 0; col < NCOLS; ++col) {
+		if (strcmp(argv[optind + 1], eve_col_names[col]) == 0) {
+			break;
+		}
+	}
+	if (col == NCOLS) {
+		printf("Unknown column %s\n", argv[optind + 1]);
+		return 1;
+	}
+	if (store_open(&s, argv[optind])
+	    || arena_init(&a, 1UL << 20, MEM_SCAN)) {
+		return 1;
+	}
+	if ((rc = dense_groupby(&s, (enum eve_col)col, &a)) >= 0) {
+		goto out;
+	}
+	rc = 0;
+	if (hashagg_init(&h, sizeof(struct group), merge, budget)) {
+		rc = 1;
+		goto out;
+	}
+	for (i = 0; i < s.nparts && rc == 0; ++i) {
+		arena_reset(&a);
+		rc = add_partition(&h, &s.parts[i], (enum eve_col)col, &a);
+	}
+	if (rc) {
+		hashagg_free(&h);
+	} else {
+		rc = hashagg_finish(&h, emit, NULL);
+		fprintf(stderr, "groupby: %llu groups, %llu rows spilled "
+		    "in %llu pages over %u files, depth %u, peak %zu kB\n",
+		    (unsigned long long)h.stats.groups,
+		    (unsigned long long)h.stats.spilled,
+		    (unsigned long long)h.stats.pages, h.stats.files,
+		    h.stats.depth, h.stats.peak >> 10);
+	}
+out:
+	arena_free(&a);
+	store_free(&s);
+	return rc;
+
+usage:
+	printf("Usage: %s [-m budgetMB] store column\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,150 @@
+#include <stdio.h>	/* printf() */
+#include <stdlib.h>	/* malloc(), strtol() */
+#include <string.h>	/* strcmp() */
+#include <unistd.h>	/* write() */
+#include <fcntl.h>	/* open() */
+
+#include "lib/gzindex.h"
+#include "lib/pool.h"
+
+/*
+ * Usage:
+ *	gzindex build file.dump.gz [spanMB]
+ *		Writes file.dump.gz.gzi with an access point every spanMB
+ *		(default 8) of uncompressed data.
+ *	gzindex cat file.dump.gz [jobs]
+ *		Like gunzip -c, but inflates up to jobs (default 4) regions
+ *		at once on as many threads using the sidecar. Output is in
+ *		file order.
+*/
+
+struct region {
+	const struct gzindex *idx;
+	int fd;
+	off_t offset;
+	size_t len;
+	unsigned char *buf;
+	ssize_t got;
+	struct pool_group group;
+};
+
+static void
+extract_region(void *arg)
+{
+	struct region *r = arg;
+	if ((r->buf = malloc(r->len + 1)) == NULL) {
+		r->got = -1;
+		return;
+	}
+	r->got = gzindex_extract(r->fd, r->idx, r->offset, r->buf, r->len);
+	return;
+}
+
+static int
+submit_region(struct pool *pool, const struct gzindex *idx, int fd,
+    struct region *r, int point)
+{
+	const int64_t end = (point + 1 < idx->have)
+	    ? idx->list[point + 1].out : idx->length;
+	r->idx = idx;
+	r->fd = fd;
+	r->offset = idx->list[point].out;
+	r->len = (size_t)(end - idx->list[point].out);
+	r->buf = NULL;
+	r->got = -1;
+	r->group.pending = 0;
+	return pool_submit(pool, POOL_LOW, extract_region, r, &r->group);
+}
+
+static int
+build(int fd, const char *sidecar, off_t span)
+{
+	struct gzindex idx;
+	int ret;
+	if ((ret = gzindex_build(fd, span, &idx)) != 0) {
+		printf("Failed to index (zlib error %d)\n", ret);
+		return 1;
+	}
+	if (gzindex_save(&idx, sidecar)) {
+		printf("Failed to write %s\n", sidecar);
+		gzindex_free(&idx);
+		return 1;
+	}
+	gzindex_free(&idx);
+	return 0;
+}
+
+/* Inflates the file region by region, jobs regions ahead of the output. */
+static int
+cat(int fd, const char *sidecar, int jobs)
+{
+	struct gzindex idx;
+	struct region *r;
+	struct pool pool;
+	int i, rc = 0;
+	if (gzindex_load(&idx, sidecar, fd)) {
+		fprintf(stderr, "Missing or stale index %s\n", sidecar);
+		return 1;
+	}
+	if ((r = calloc((size_t)jobs, sizeof(*r))) == NULL
+	    || pool_init(&pool, (unsigned int)jobs)) {
+		free(r);
+		gzindex_free(&idx);
+		return 1;
+	}
+	for (i = 0; i < jobs && i < idx.have && !rc; ++i) {
+		rc = submit_region(&pool, &idx, fd, &r[i], i);
+	}
+	for (i = 0; i < idx.have && !rc; ++i) { /* Write in order. */
+		struct region *cur = &r[i % jobs];
+		pool_wait(&pool, &cur->group);
+		if (cur->got != (ssize_t)cur->len) {
+			fprintf(stderr, "Failed to inflate at %lld\n",
+			    (long long)cur->offset);
+			rc = 1;
+		} else if (write(STDOUT_FILENO, cur->buf, cur->len)
+		    != (ssize_t)cur->len) {
+			perror("write()");
+			rc = 1;
+		}
+		free(cur->buf);
+		cur->buf = NULL;
+		if (!rc && i + jobs < idx.have) {
+			rc = submit_region(&pool, &idx, fd, cur, i + jobs);
+		}
+	}
+	pool_free(&pool); /* Finishes anything still in flight. */
+	for (i = 0; i < jobs; ++i) {
+		free(r[i].buf);
+	}
+	free(r);
+	gzindex_free(&idx);
+	return rc;
+}
+
+int
+main(int argc, char** argv)
+{
+	int fd, rc;
+	long arg;
+	char sidecar[4096];
+	if (argc < 3 || (strcmp(argv[1], "build") && strcmp(argv[1], "cat"))) {
+		printf("Usage: %s build|cat file.dump.gz [spanMB|jobs]\n",
+		    argv[0]);
+		return 1;
+	}
+	if ((fd = open(argv[2], O_RDONLY)) == -1) {
+		perror(argv[2]);
+		return 1;
+	}
+	snprintf(sidecar, sizeof(sidecar), "%s.gzi", argv[2]);
+	if (strcmp(argv[1], "build") == 0) {
+		arg = (argc > 3) ? strtol(argv[3], NULL, 10) : 8;
+		rc = build(fd, sidecar, (off_t)(arg > 0 ? arg : 8) << 20);
+	} else {
+		arg = (argc > 3) ? strtol(argv[3], NULL, 10) : 4;
+		rc = cat(fd, sidecar, (int)(arg > 0 ? arg : 4));
+	}
+	close(fd);
+	return rc;
+}
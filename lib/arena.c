@@ -0,0 +1,71 @@
+#include "arena.h"
+
+#include <stdio.h>	/* printf() */
+#include <assert.h>	/* assert() */
+
+#include "mem.h"
+
+int
+arena_init(struct arena *a, size_t cap, enum mem_tag tag)
+{
+	{ /* Preconditions */
+		assert(a != NULL);
+		assert(cap > 0);
+	}
+	if ((a->base = mem_huge_alloc(cap, tag)) == NULL) {
+		return 1;
+	}
+	a->tag = tag;
+	a->use = a->peak = 0;
+	a->cap = cap;
+	a->allocs = a->fails = a->resets = 0;
+	return 0;
+}
+
+void
+arena_free(struct arena *a)
+{
+	mem_huge_free(a->base, a->cap, a->tag);
+	a->base = NULL;
+	a->use = a->cap = 0;
+	return;
+}
+
+void *
+arena_alloc(struct arena *a, size_t size)
+{
+	void *p;
+	const size_t len = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN-1);
+	{ /* Preconditions */
+		assert(a != NULL);
+		assert(a->use <= a->cap);
+	}
+	if (len < size || len > a->cap - a->use) {
+		a->fails++;
+		return NULL;
+	}
+	p = a->base + a->use;
+	a->use += len;
+	a->allocs++;
+	if (a->use > a->peak) {
+		a->peak = a->use;
+	}
+	return p;
+}
+
+void
+arena_reset(struct arena *a)
+{
+	a->use = 0;
+	a->resets++;
+	return;
+}
+
+void
+arena_report(const struct arena *a, const char *name)
+{
+	printf("%s: arena %zu/%zu kB in use, peak %zu kB, %lu allocs, "
+	    "%lu failed, %lu resets\n", name, a->use >> 10, a->cap >> 10,
+	    a->peak >> 10, a->allocs, a->fails, a->resets);
+	return;
+}
@@ -0,0 +1,50 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stddef.h>	/* size_t */
+
+#include "mem.h"	/* enum mem_tag */
+
+/*
+ * Bump allocator for per-dump and per-query scratch memory.
+ *
+ * An arena is one fixed block (on huge pages when large enough, see
+ * mem.h) that hands out memory by bumping an offset. Nothing is freed
+ * individually; arena_reset() drops everything at a dump or query
+ * boundary, so a long-running process reuses the same block forever
+ * instead of fragmenting the heap. Running out returns NULL rather than
+ * growing, so the caller decides whether that's an error or a flush.
+*/
+
+#define ARENA_ALIGN 16
+
+struct arena {
+	char *base;
+	size_t use;
+	size_t cap;
+	enum mem_tag tag;	/* What the block is charged to. */
+	/* Statistics, kept across resets. */
+	size_t peak;		/* Highest use seen. */
+	unsigned long allocs;	/* Successful arena_alloc() calls. */
+	unsigned long fails;	/* arena_alloc() calls that didn't fit. */
+	unsigned long resets;
+};
+
+/* Returns 0 on success, 1 if the block can't be allocated. */
+int
+arena_init(struct arena *a, size_t cap, enum mem_tag tag);
+
+void
+arena_free(struct arena *a);
+
+/* Returns ARENA_ALIGN aligned memory, or NULL if it doesn't fit. */
+void *
+arena_alloc(struct arena *a, size_t size);
+
+void
+arena_reset(struct arena *a);
+
+void
+arena_report(const struct arena *a, const char *name);
+
+#endif
@@ -0,0 +1,46 @@
+#include "asof.h"
+
+#include <assert.h>	/* assert() */
+
+void
+asof_init(struct asof *a, uint32_t tolerance)
+{
+	a->tolerance = tolerance;
+	a->have = 0;
+	a->ts = a->val = 0;
+	return;
+}
+
+size_t
+asof_next(struct asof *a, const uint64_t *lts, size_t ln,
+    const uint64_t *rts, const uint64_t *rval, size_t *rn, int rlast,
+    uint64_t *out, uint8_t *hit)
+{
+	const size_t n = *rn;
+	size_t i, j = 0;
+	{ /* Preconditions */
+		assert(a != NULL);
+		assert(rn != NULL);
+	}
+	for (i = 0; i < ln; ++i) {
+		const uint64_t ts = lts[i];
+		const size_t from = j;
+		while (j < n && rts[j] <= ts) {
+			j++;
+		}
+		if (j > from) {
+			a->have = 1;
+			a->ts = rts[j - 1];
+			a->val = rval[j - 1];
+		}
+		if (j == n && !rlast) { /* The next batch may still match. */
+			break;
+		}
+		/* Same key, and not too old; no branches on the data. */
+		hit[i] = (uint8_t)(a->have & ((a->ts >> 32) == (ts >> 32))
+		    & ((uint32_t)ts - (uint32_t)a->ts <= a->tolerance));
+		out[i] = a->val;
+	}
+	*rn = j;
+	return i;
+}
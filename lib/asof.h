@@ -0,0 +1,40 @@
+#ifndef ASOF_H_
+#define ASOF_H_
+
+#include <stddef.h>	/* size_t */
+#include <stdint.h>	/* uint*_t */
+
+/*
+ * As-of join: each row of a left series gets the latest row of a right
+ * series with the same key, no later than it and at most tolerance seconds
+ * before it. Both series are streams of column batches sorted by
+ * ASOF_TS(key, rtime), so the join is one merge pass with no per-key
+ * state. Right rows can arrive in any batch sizes; asof_next() says how
+ * far it got through both.
+*/
+
+#define ASOF_TS(key, rtime) ((uint64_t)(key) << 32 | (uint32_t)(rtime))
+
+struct asof {
+	uint32_t tolerance;
+	int have;	/* Whether ts and val hold a right row. */
+	uint64_t ts;	/* Latest right row consumed. */
+	uint64_t val;
+};
+
+void
+asof_init(struct asof *a, uint32_t tolerance);
+
+/*
+ * Joins left rows lts[0..ln) against right rows rts/rval[0..*rn). For
+ * each left row i done, hit[i] says whether it matched and out[i] holds
+ * the right value. Returns the left rows done and sets *rn to the right
+ * rows consumed. Stops at a left row the right batch may not cover yet,
+ * unless rlast says there are no right rows after these.
+*/
+size_t
+asof_next(struct asof *a, const uint64_t *lts, size_t ln,
+    const uint64_t *rts, const uint64_t *rval, size_t *rn, int rlast,
+    uint64_t *out, uint8_t *hit);
+
+#endif
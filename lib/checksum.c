@@ -0,0 +1,332 @@
+#include "checksum.h"
+
+#include <stdio.h>	/* fopen(), printf() */
+#include <stdlib.h>	/* getenv(), atoi() */
+#include <string.h>	/* memcmp(), memmove(), strerror() */
+#include <errno.h>	/* errno */
+#include <fcntl.h>	/* open(), posix_fadvise() */
+#include <unistd.h>	/* read(), close() */
+#include <assert.h>	/* assert() */
+
+#include "crc32c.h"
+#include "scan.h"
+
+#define CHECKSUM_MAGIC "EVECRC1"
+
+/* Read at a time by builds and scrubs, a whole number of row groups. */
+#define CHUNK (4UL << 20)
+
+/* Reads up to len bytes, fewer only at the end of the file or on errors. */
+static ssize_t
+read_full(int fd, char *buf, size_t len)
+{
+	size_t use = 0;
+	ssize_t rb;
+	while (use < len) {
+		if ((rb = read(fd, buf + use, len - use)) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		} else if (rb == 0) {
+			break;
+		}
+		use += (size_t)rb;
+	}
+	return (ssize_t)use;
+}
+
+/*
+ * Checksums every row group of column col of p into crc, reading it
+ * straight through with buf, of CHUNK bytes. Adds what it read to bytes.
+*/
+static int
+column_crcs(const struct partition *p, enum eve_col col, uint32_t *crc,
+    char *buf, uint64_t *bytes)
+{
+	const size_t groupBytes = SCAN_GROUP * (size_t)eve_col_sizes[col];
+	const size_t chunk = CHUNK / groupBytes * groupBytes;
+	const uint64_t want = p->rows * eve_col_sizes[col];
+	char path[STORE_PATHLEN];
+	uint64_t use = 0, g = 0;
+	ssize_t rb;
+	size_t off;
+	int fd, over;
+	store_colpath(p, col, path);
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		printf("Failed to open %s with error: %s\n", path,
+		    strerror(errno));
+		return 1;
+	}
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	/* Never past want, so crc only gets the row groups it has room for. */
+	while (use < want && (rb = read_full(fd, buf, (want - use < chunk)
+	    ? (size_t)(want - use) : chunk)) > 0) {
+		for (off = 0; off < (size_t)rb; off += groupBytes) {
+			const size_t n = ((size_t)rb - off < groupBytes)
+			    ? (size_t)rb - off : groupBytes;
+			crc[g++] = crc32c(0, buf + off, n);
+		}
+		use += (uint64_t)rb;
+	}
+	over = use == want && read_full(fd, buf, 1) > 0;
+	close(fd);
+	*bytes += use;
+	if (use != want || over) {
+		printf("%s column %s: %llu rows of %u bytes expected\n",
+		    over ? "Long" : "Short", path,
+		    (unsigned long long)p->rows, eve_col_sizes[col]);
+		return 1;
+	}
+	return 0;
+}
+
+static int
+alloc_crcs(struct checksums *c, struct arena *a)
+{
+	int col;
+	for (col = 0; col < NCOLS; ++col) {
+		c->crc[col] = arena_alloc(a, sizeof(uint32_t) * (c->ngroups
+		    + 1));
+		if (c->crc[col] == NULL) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int
+checksum_build(struct checksums *c, const struct partition *p,
+    struct arena *a)
+{
+	uint64_t bytes = 0;
+	char *buf;
+	int col;
+	{ /* Preconditions */
+		assert(c != NULL);
+		assert(p != NULL);
+		assert(a != NULL);
+	}
+	c->rows = p->rows;
+	c->ngroups = scan_ngroups(p);
+	if (alloc_crcs(c, a) || (buf = arena_alloc(a, CHUNK)) == NULL) {
+		return 1;
+	}
+	for (col = 0; col < NCOLS; ++col) {
+		if (column_crcs(p, (enum eve_col)col, c->crc[col], buf,
+		    &bytes)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* fwrite() that also checksums what it writes. */
+static int
+put(const void *buf, size_t len, FILE *f, uint32_t *crc)
+{
+	*crc = crc32c(*crc, buf, len);
+	return len > 0 && fwrite(buf, len, 1, f) != 1;
+}
+
+int
+checksum_save(const struct checksums *c, const struct partition *p)
+{
+	char path[STORE_PATHLEN], tmp[STORE_PATHLEN];
+	uint32_t crc = 0;
+	FILE *f;
+	int col, rc;
+	store_path(p, CHECKSUM_FILE, path);
+	store_path(p, CHECKSUM_FILE ".tmp", tmp);
+	if (!(f = fopen(tmp, "wb"))) {
+		printf("Failed to open %s\n", tmp);
+		return 1;
+	}
+	rc = put(CHECKSUM_MAGIC, sizeof(CHECKSUM_MAGIC), f, &crc)
+	    || put(&c->rows, sizeof(c->rows), f, &crc)
+	    || put(&c->ngroups, sizeof(c->ngroups), f, &crc);
+	for (col = 0; col < NCOLS && !rc; ++col) {
+		rc = put(c->crc[col], sizeof(uint32_t) * c->ngroups, f, &crc);
+	}
+	rc = rc || fwrite(&crc, sizeof(crc), 1, f) != 1;
+	/* Scrubs may be reading the old ones; swap them in whole. */
+	if (fclose(f) || rc || rename(tmp, path)) {
+		printf("Failed to write %s\n", path);
+		remove(tmp);
+		return 1;
+	}
+	return 0;
+}
+
+/* fread() that also checksums what it reads. */
+static int
+get(void *buf, size_t len, FILE *f, uint32_t *crc)
+{
+	if (len > 0 && fread(buf, len, 1, f) != 1) {
+		return 1;
+	}
+	*crc = crc32c(*crc, buf, len);
+	return 0;
+}
+
+/*
+ * Whether the rest of f matches the checksum that ends it, given crc of
+ * what came before. For a header that doesn't fit p, which can't be
+ * trusted to size the rest.
+*/
+static int
+rest_ok(FILE *f, uint32_t crc)
+{
+	unsigned char buf[4096 + sizeof(uint32_t)];
+	size_t have = 0, n;
+	uint32_t saved;
+	while ((n = fread(buf + have, 1, sizeof(buf) - have, f)) > 0) {
+		have += n;
+		if (have > sizeof(saved)) { /* Keep the last 4 bytes back. */
+			crc = crc32c(crc, buf, have - sizeof(saved));
+			memmove(buf, buf + have - sizeof(saved), sizeof(saved));
+			have = sizeof(saved);
+		}
+	}
+	memcpy(&saved, buf, sizeof(saved));
+	return !ferror(f) && have == sizeof(saved) && saved == crc;
+}
+
+int
+checksum_load(struct checksums *c, const struct partition *p,
+    struct arena *a)
+{
+	char path[STORE_PATHLEN], magic[sizeof(CHECKSUM_MAGIC)];
+	uint32_t crc = 0, saved;
+	FILE *f;
+	int col, rc = CHECKSUM_CORRUPT;
+	{ /* Preconditions */
+		assert(c != NULL);
+		assert(p != NULL);
+		assert(a != NULL);
+	}
+	store_path(p, CHECKSUM_FILE, path);
+	if (!(f = fopen(path, "rb"))) {
+		if (errno == ENOENT) {
+			return CHECKSUM_MISSING;
+		}
+		printf("Failed to open %s with error: %s\n", path,
+		    strerror(errno));
+		return CHECKSUM_CORRUPT;
+	}
+	if (get(magic, sizeof(magic), f, &crc)
+	    || memcmp(magic, CHECKSUM_MAGIC, sizeof(magic))
+	    || get(&c->rows, sizeof(c->rows), f, &crc)
+	    || get(&c->ngroups, sizeof(c->ngroups), f, &crc)) {
+		goto out;
+	}
+	if (c->rows != p->rows || c->ngroups != scan_ngroups(p)) {
+		if (rest_ok(f, crc)) {
+			printf("Stale checksums: %s, of %llu rows, not %llu\n",
+			    path, (unsigned long long)c->rows,
+			    (unsigned long long)p->rows);
+			rc = CHECKSUM_STALE;
+		}
+		goto out;
+	}
+	if (alloc_crcs(c, a)) {
+		goto out;
+	}
+	for (col = 0; col < NCOLS; ++col) {
+		if (get(c->crc[col], sizeof(uint32_t) * c->ngroups, f, &crc)) {
+			goto out;
+		}
+	}
+	if (fread(&saved, sizeof(saved), 1, f) == 1 && saved == crc) {
+		rc = CHECKSUM_OK;
+	}
+out:
+	if (rc == CHECKSUM_CORRUPT) {
+		printf("Corrupt checksums: %s\n", path);
+	}
+	fclose(f);
+	return rc;
+}
+
+int
+checksum_collect(const char *dir)
+{
+	struct partition p;
+	struct checksums c;
+	struct arena a;
+	int rc;
+	if (partition_init(&p, dir, "")) {
+		printf("No columns in %s\n", dir);
+		return 1;
+	}
+	if (arena_init(&a, CHUNK + NCOLS * (scan_ngroups(&p) + 1) * 4 + 4096,
+	    MEM_INDEX)) {
+		return 1;
+	}
+	rc = checksum_build(&c, &p, &a) || checksum_save(&c, &p);
+	arena_free(&a);
+	return rc;
+}
+
+int
+checksum_on_read(void)
+{
+	const char *env = getenv("EVE_VERIFY");
+	return env != NULL && atoi(env) != 0;
+}
+
+int
+checksum_group(const struct checksums *c, enum eve_col col, uint64_t g,
+    const void *buf, size_t len)
+{
+	{ /* Preconditions */
+		assert(c != NULL);
+		assert(col < NCOLS);
+		assert(g < c->ngroups);
+	}
+	return crc32c(0, buf, len) != c->crc[col][g];
+}
+
+int
+checksum_scrub(const struct partition *p, struct scrub_stats *st,
+    struct arena *a)
+{
+	struct checksums c;
+	uint32_t *crc;
+	uint64_t g;
+	char *buf;
+	int col, rc = 0;
+	{ /* Preconditions */
+		assert(p != NULL);
+		assert(st != NULL);
+		assert(a != NULL);
+	}
+	if ((rc = checksum_load(&c, p, a)) != CHECKSUM_OK) {
+		if (rc == CHECKSUM_MISSING) {
+			printf("No checksums in %s\n", p->dir);
+		}
+		return 1;
+	}
+	crc = arena_alloc(a, sizeof(*crc) * (c.ngroups + 1));
+	if (crc == NULL || (buf = arena_alloc(a, CHUNK)) == NULL) {
+		return 1;
+	}
+	for (col = 0; col < NCOLS; ++col) {
+		if (column_crcs(p, (enum eve_col)col, crc, buf, &st->bytes)) {
+			st->bad += c.ngroups;
+			rc = 1;
+			continue;
+		}
+		for (g = 0; g < c.ngroups; ++g) {
+			if (crc[g] != c.crc[col][g]) {
+				printf("Checksum mismatch: %s%s, row group "
+				    "%llu\n", p->dir, eve_col_names[col],
+				    (unsigned long long)g);
+				st->bad++;
+				rc = 1;
+			}
+		}
+		st->groups += c.ngroups;
+	}
+	return rc;
+}
@@ -0,0 +1,83 @@
+#ifndef CHECKSUM_H_
+#define CHECKSUM_H_
+
+#include <stddef.h>	/* size_t */
+#include <stdint.h>	/* uint*_t */
+
+#include "arena.h"	/* struct arena */
+#include "eve_txn.h"	/* enum eve_col */
+#include "store.h"	/* struct partition */
+
+/*
+ * Checksums of a partition's columns: a CRC-32C (see crc32c.h) of every
+ * row group (SCAN_GROUP rows) of every converter column, saved next to
+ * them in CHECKSUM_FILE, which has a checksum of its own. The converter's
+ * writers compute them once a partition is written.
+ *
+ * With EVE_VERIFY=1, scans check each row group they read against them,
+ * and spill files check their pages (see queue_page_check()). scrub.c
+ * checks whole stores without decoding anything, at disk speed.
+*/
+
+#define CHECKSUM_FILE "CHECKSUMS"
+
+struct checksums {
+	uint64_t rows;
+	uint64_t ngroups;
+	uint32_t *crc[NCOLS];	/* Per row group, from the arena. */
+};
+
+/* What a scrub read and found. */
+struct scrub_stats {
+	uint64_t bytes;
+	uint64_t groups;
+	uint64_t bad;		/* Row groups whose checksum doesn't match. */
+};
+
+/* Reads every column of p to checksum it. Returns 0 on success. */
+int
+checksum_build(struct checksums *c, const struct partition *p,
+    struct arena *a);
+
+int
+checksum_save(const struct checksums *c, const struct partition *p);
+
+/* checksum_load() results. Only a missing file is no news. */
+#define CHECKSUM_OK 0
+#define CHECKSUM_MISSING 1	/* Written before checksums were. */
+#define CHECKSUM_CORRUPT 2	/* Fails its own checksum, or unreadable. */
+#define CHECKSUM_STALE 3	/* Intact, but p has a different row count. */
+
+/*
+ * Returns one of the above, printing why unless it's CHECKSUM_OK or
+ * CHECKSUM_MISSING. A stale file means the columns changed (a truncated
+ * orderid, say) since they were checksummed, so it's as bad as a corrupt
+ * one.
+*/
+int
+checksum_load(struct checksums *c, const struct partition *p,
+    struct arena *a);
+
+/* Builds and saves the checksums of the partition in dir. */
+int
+checksum_collect(const char *dir);
+
+/* Whether EVE_VERIFY asks readers to check what they read. */
+int
+checksum_on_read(void);
+
+/* Returns 0 if the len bytes at buf are row group g of col, as saved. */
+int
+checksum_group(const struct checksums *c, enum eve_col col, uint64_t g,
+    const void *buf, size_t len);
+
+/*
+ * Reads every column of p against its checksums, reporting each row
+ * group that doesn't match, and adds to st. Returns 0 if all of them
+ * matched, 1 if not or p couldn't be checked, even for lack of checksums.
+*/
+int
+checksum_scrub(const struct partition *p, struct scrub_stats *st,
+    struct arena *a);
+
+#endif
@@ -0,0 +1,70 @@
+#include "cpu.h"
+
+#include <stdio.h>	/* printf() */
+#include <stdlib.h>	/* getenv() */
+#include <string.h>	/* strcmp() */
+
+static enum cpu_level selected = CPU_SCALAR;
+
+static const char* const names[] = { "scalar", "sse42", "avx2", "avx512" };
+
+/* What the hardware (and OS, for the AVX state) actually supports. */
+static enum cpu_level
+cpu_detect(void)
+{
+#if CPU_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")
+	    && __builtin_cpu_supports("avx512bw")) {
+		return CPU_AVX512;
+	}
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2")) {
+		return CPU_AVX2;
+	}
+	if (__builtin_cpu_supports("sse4.2")
+	    && __builtin_cpu_supports("popcnt")) {
+		return CPU_SSE42;
+	}
+#endif
+	return CPU_SCALAR;
+}
+
+enum cpu_level
+cpu_init(void)
+{
+	const enum cpu_level detected = cpu_detect();
+	const char* const force = getenv("EVE_CPU");
+	unsigned int i;
+
+	selected = detected;
+	if (force == NULL) {
+		return selected;
+	}
+	for (i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+		if (strcmp(force, names[i]) == 0) {
+			break;
+		}
+	}
+	if (i == sizeof(names) / sizeof(names[0])) {
+		printf("Unknown EVE_CPU=%s, using %s\n",
+		    force, names[detected]);
+	} else if ((enum cpu_level)i > detected) {
+		printf("EVE_CPU=%s not supported here, using %s\n",
+		    force, names[detected]);
+	} else {
+		selected = (enum cpu_level)i;
+	}
+	return selected;
+}
+
+enum cpu_level
+cpu_level(void)
+{
+	return selected;
+}
+
+const char *
+cpu_level_name(enum cpu_level level)
+{
+	return names[level];
+}
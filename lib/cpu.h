@@ -0,0 +1,41 @@
+#ifndef CPU_H_
+#define CPU_H_
+
+/*
+ * Runtime CPU feature dispatch.
+ *
+ * SIMD kernels are compiled once per ISA level with the CPU_TARGET_*
+ * attributes below (no special build flags needed), and the caller picks
+ * one through cpu_level(). The level is detected once by cpu_init() at
+ * startup. Setting EVE_CPU=scalar|sse42|avx2|avx512 forces a lower level
+ * for testing; asking for more than the machine has is ignored.
+*/
+
+enum cpu_level {
+	CPU_SCALAR = 0,
+	CPU_SSE42,	/* SSE4.2 + POPCNT */
+	CPU_AVX2,	/* AVX2 + BMI2 */
+	CPU_AVX512	/* AVX-512 F + BW */
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_X86 1
+#define CPU_TARGET_SSE42 __attribute__((target("sse4.2,popcnt")))
+#define CPU_TARGET_AVX2 __attribute__((target("avx2,bmi2")))
+#define CPU_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#else
+#define CPU_X86 0
+#endif
+
+/* Detects the CPU level and applies EVE_CPU. Returns the level in use. */
+enum cpu_level
+cpu_init(void);
+
+/* The level selected by cpu_init(), CPU_SCALAR before it's called. */
+enum cpu_level
+cpu_level(void);
+
+const char *
+cpu_level_name(enum cpu_level level);
+
+#endif
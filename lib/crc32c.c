@@ -0,0 +1,83 @@
+#include "crc32c.h"
+
+#include <string.h>	/* memcpy() */
+#include <pthread.h>	/* pthread_once() */
+#include <assert.h>	/* assert() */
+
+#include "cpu.h"
+
+#if CPU_X86
+#include <nmmintrin.h>	/* _mm_crc32_u64() */
+#endif
+
+/*
+ * A nibble at a time, so the table (of the reflected polynomial 0x82f63b78)
+ * is small enough to spell out.
+*/
+static uint32_t
+crc32c_scalar(uint32_t crc, const unsigned char *p, size_t len)
+{
+	static const uint32_t nibble[16] = {
+		0x00000000, 0x105ec76f, 0x20bd8ede, 0x30e349b1,
+		0x417b1dbc, 0x5125dad3, 0x61c69362, 0x7198540d,
+		0x82f63b78, 0x92a8fc17, 0xa24bb5a6, 0xb21572c9,
+		0xc38d26c4, 0xd3d3e1ab, 0xe330a81a, 0xf36e6f75
+	};
+	size_t i;
+	for (i = 0; i < len; ++i) {
+		crc ^= p[i];
+		crc = (crc >> 4) ^ nibble[crc & 15];
+		crc = (crc >> 4) ^ nibble[crc & 15];
+	}
+	return crc;
+}
+
+#if CPU_X86
+CPU_TARGET_SSE42 static uint32_t
+crc32c_sse42(uint32_t crc, const unsigned char *p, size_t len)
+{
+	uint64_t c = crc, v;
+	for (; len >= 8; p += 8, len -= 8) {
+		memcpy(&v, p, sizeof(v));
+		c = _mm_crc32_u64(c, v);
+	}
+	crc = (uint32_t)c;
+	for (; len > 0; ++p, --len) {
+		crc = _mm_crc32_u8(crc, *p);
+	}
+	return crc;
+}
+#endif
+
+static uint32_t (*kernel)(uint32_t crc, const unsigned char *p, size_t len);
+static pthread_once_t picked = PTHREAD_ONCE_INIT;
+
+/*
+ * Most readers only checksum with EVE_VERIFY and never call cpu_init();
+ * they should still get the fast kernel, so detect the level if nobody
+ * has.
+*/
+static void
+pick(void)
+{
+	enum cpu_level level = cpu_level();
+	if (level == CPU_SCALAR) {
+		level = cpu_init();
+	}
+	kernel = crc32c_scalar;
+#if CPU_X86
+	if (level >= CPU_SSE42) {
+		kernel = crc32c_sse42;
+	}
+#endif
+}
+
+uint32_t
+crc32c(uint32_t crc, const void *buf, size_t len)
+{
+	{ /* Preconditions */
+		assert(buf != NULL || len == 0);
+	}
+	pthread_once(&picked, pick);
+	return ~kernel(~crc, buf, len);
+}
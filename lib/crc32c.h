@@ -0,0 +1,22 @@
+#ifndef CRC32C_H_
+#define CRC32C_H_
+
+#include <stddef.h>	/* size_t */
+#include <stdint.h>	/* uint*_t */
+
+/*
+ * CRC-32C (Castagnoli), as iSCSI and ext4 use it, for checksums of pages
+ * and row groups. The SSE4.2 crc32 instruction computes it 8 bytes at a
+ * time; the first call picks that kernel if cpu_level() allows it
+ * (running cpu_init() if nobody has), and a table driven one otherwise.
+ * Both give the same checksums.
+*/
+
+/*
+ * Extends crc, 0 to start with, over len bytes of buf:
+ * crc32c(crc32c(0, a, n), b, m) is the checksum of a followed by b.
+*/
+uint32_t
+crc32c(uint32_t crc, const void *buf, size_t len);
+
+#endif
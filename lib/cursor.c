@@ -0,0 +1,270 @@
+#include "cursor.h"
+
+#include <stdlib.h>	/* free(), malloc() */
+#include <string.h>	/* memcmp(), memset(), strlen() */
+#include <sys/stat.h>	/* stat() */
+#include <assert.h>	/* assert() */
+
+#include "plan.h"
+#include "stats.h"
+
+static uint64_t
+fnv(uint64_t h, const void *buf, size_t len)
+{
+	const unsigned char *p = buf;
+	size_t i;
+	for (i = 0; i < len; ++i) {
+		h = (h ^ p[i]) * 1099511628211ULL;
+	}
+	return h;
+}
+
+/* Which copy of p is there now (a re-sent segment is a new directory). */
+static uint64_t
+copy_of(const struct partition *p)
+{
+	struct stat st;
+	return (stat(p->dir, &st) == 0) ? (uint64_t)st.st_ino : 0;
+}
+
+/*
+ * Identifies the first n partitions of s: where they are, how long, and
+ * which copy, each of which goes into ino if it's not NULL. Never 0.
+*/
+static uint64_t
+pin(const struct store *s, uint32_t n, uint64_t *ino)
+{
+	uint64_t h = 14695981039346656037ULL, copy;
+	uint32_t i;
+	for (i = 0; i < n; ++i) {
+		const struct partition *p = &s->parts[i];
+		copy = copy_of(p);
+		h = fnv(h, p->dir, strlen(p->dir));
+		h = fnv(h, &p->rows, sizeof(p->rows));
+		h = fnv(h, &copy, sizeof(copy));
+		if (ino != NULL) {
+			ino[i] = copy;
+		}
+	}
+	return h | 1;
+}
+
+static void
+close_scan(struct cursor *c)
+{
+	if (c->open) {
+		scan_close(&c->scan);
+	}
+	c->open = c->have = 0;
+}
+
+static void
+next_part(struct cursor *c)
+{
+	close_scan(c);
+	c->pos.part++;
+	c->pos.group = 0;
+	c->pos.row = 0;
+}
+
+/*
+ * Opens the scan of partition pos.part from row group pos.group on, as
+ * planned, or moves past the partition if it's pruned. The manifest
+ * isn't reread while a cursor carries on, so this is where a re-sent
+ * partition shows. Returns a reply code.
+*/
+static int
+open_scan(struct cursor *c)
+{
+	const struct partition *p = &c->store.parts[c->pos.part];
+	const uint64_t ngroups = scan_ngroups(p);
+	struct stats st;
+	struct plan pl;
+	uint8_t *keep;
+	uint64_t g;
+	if (copy_of(p) != c->ino[c->pos.part]) {
+		return CURSOR_STALE;
+	}
+	arena_reset(c->a);
+	if ((keep = arena_alloc(c->a, ngroups + 1)) == NULL) {
+		return CURSOR_FAILED;
+	}
+	plan_partition(&pl, p, stats_load(&st, p, c->a) ? NULL : &st, &c->q,
+	    keep);
+	if (pl.path == PLAN_PRUNE) {
+		next_part(c);
+		return CURSOR_OK;
+	}
+	for (g = 0; g < ngroups; ++g) {
+		keep[g] = g >= c->pos.group
+		    && (pl.path == PLAN_SCAN || keep[g]);
+	}
+	if (scan_open(&c->scan, p, CURSOR_COLS, keep, 0, c->a)) {
+		return CURSOR_FAILED;
+	}
+	c->open = 1;
+	return CURSOR_OK;
+}
+
+static void
+put_row(struct cursor_row *r, const struct scan_batch *b, uint32_t i)
+{
+	r->orderID = ((const uint64_t *)b->col[COL_ORDERID])[i];
+	r->price = ((const uint64_t *)b->col[COL_PRICE])[i];
+	r->regionID = ((const uint32_t *)b->col[COL_REGIONID])[i];
+	r->stationID = ((const uint32_t *)b->col[COL_STATIONID])[i];
+	r->typeID = ((const uint32_t *)b->col[COL_TYPEID])[i];
+	r->volMin = ((const uint32_t *)b->col[COL_VOLMIN])[i];
+	r->volRem = ((const uint32_t *)b->col[COL_VOLREM])[i];
+	r->issued = ((const uint32_t *)b->col[COL_ISSUED])[i];
+	r->rtime = ((const uint32_t *)b->col[COL_RTIME])[i];
+	r->duration = ((const uint16_t *)b->col[COL_DURATION])[i];
+	r->range = ((const int8_t *)b->col[COL_RANGE])[i];
+	r->bid = ((const uint8_t *)b->col[COL_BID])[i];
+	r->pad = 0;
+}
+
+void
+cursor_init(struct cursor *c, const char *root, struct arena *a)
+{
+	{ /* Preconditions */
+		assert(c != NULL);
+		assert(root != NULL);
+		assert(a != NULL);
+	}
+	memset(c, 0, sizeof(*c));
+	c->root = root;
+	c->a = a;
+	c->store.parts = NULL;
+	c->ino = NULL;
+}
+
+/* Whether c is where req left off, so it needn't look at the manifest. */
+static int
+in_place(const struct cursor *c, const struct cursor_req *req)
+{
+	return req->pos.pin != 0 && c->store.parts != NULL
+	    && memcmp(&c->pos, &req->pos, sizeof(req->pos)) == 0
+	    && memcmp(&c->q, &req->q, sizeof(req->q)) == 0;
+}
+
+/*
+ * Points c at req->pos over the store now, which it takes. Returns a
+ * reply code.
+*/
+static int
+seek(struct cursor *c, const struct cursor_req *req, struct store *now)
+{
+	const struct cursor_pos *pos = &req->pos;
+	const uint32_t n = (pos->pin == 0) ? now->nparts : pos->nparts;
+	uint64_t *ino, h;
+	if (now->nparts < n) {
+		store_free(now);
+		return CURSOR_STALE;
+	}
+	if ((ino = malloc((n + 1) * sizeof(*ino))) == NULL) {
+		store_free(now);
+		return CURSOR_FAILED;
+	}
+	h = pin(now, n, ino);
+	if (pos->pin != 0 && h != pos->pin) {
+		free(ino);
+		store_free(now);
+		return CURSOR_STALE;
+	}
+	cursor_free(c);
+	c->store = *now;
+	c->ino = ino;
+	c->q = req->q;
+	if (pos->pin == 0) { /* A new cursor, pinned to what's there now. */
+		c->pos.nparts = n;
+		c->pos.pin = h;
+	} else {
+		c->pos = *pos;
+	}
+	return CURSOR_OK;
+}
+
+void
+cursor_page(struct cursor *c, const struct cursor_req *req,
+    struct cursor_reply *r)
+{
+	const uint32_t limit = (req->limit < CURSOR_PAGEMAX) ? req->limit
+	    : CURSOR_PAGEMAX;
+	uint32_t sel[CURSOR_PAGEMAX];
+	struct store now;
+	size_t i, n, want;
+	int rc;
+	{ /* Preconditions */
+		assert(c != NULL);
+		assert(req != NULL);
+		assert(r != NULL);
+	}
+	memset(r, 0, sizeof(*r));
+	r->pos = req->pos;
+	if (!in_place(c, req)) {
+		if (store_open(&now, c->root)) {
+			r->rc = CURSOR_FAILED;
+			return;
+		}
+		if ((r->rc = seek(c, req, &now)) != CURSOR_OK) {
+			return;
+		}
+	}
+	while (r->n < limit && c->pos.part < c->pos.nparts) {
+		if (!c->open) {
+			if ((rc = open_scan(c)) != CURSOR_OK) {
+				goto fail;
+			}
+			continue;
+		}
+		if (!c->have) {
+			if ((rc = scan_next(&c->scan, &c->b)) < 0) {
+				rc = CURSOR_FAILED;
+				goto fail;
+			} else if (rc == 1) {
+				next_part(c);
+				continue;
+			}
+			if (c->b.first / SCAN_GROUP != c->pos.group) {
+				c->pos.group = c->b.first / SCAN_GROUP;
+				c->pos.row = 0;
+			}
+			c->have = 1;
+		}
+		want = limit - r->n;
+		n = query_select(&c->q, &c->b, c->pos.row, want, sel);
+		for (i = 0; i < n; ++i) {
+			put_row(&r->rows[r->n++], &c->b, sel[i]);
+		}
+		c->pos.row = (n == want) ? sel[n - 1] + 1 : (uint32_t)c->b.n;
+		if (c->pos.row == c->b.n) {
+			c->have = 0;
+			c->pos.group++;
+			c->pos.row = 0;
+		}
+	}
+	if (c->pos.part == c->pos.nparts) {
+		close_scan(c);
+		c->pos.done = 1;
+	}
+	c->pos.returned += r->n;
+	r->pos = c->pos;
+	return;
+
+fail:
+	/* Nothing to resume from; the client may retry from req->pos. */
+	cursor_free(c);
+	r->rc = rc;
+	r->n = 0;
+}
+
+void
+cursor_free(struct cursor *c)
+{
+	close_scan(c);
+	store_free(&c->store);
+	free(c->ino);
+	c->ino = NULL;
+	memset(&c->pos, 0, sizeof(c->pos));
+}
@@ -0,0 +1,109 @@
+#ifndef CURSOR_H_
+#define CURSOR_H_
+
+#include <stdint.h>	/* uint*_t */
+
+#include "arena.h"	/* struct arena */
+#include "query.h"	/* struct query */
+#include "scan.h"	/* struct scan */
+#include "store.h"	/* struct store */
+
+/*
+ * Resumable cursors: the rows a query's filters match (see query.h), a
+ * page at a time, for clients that page through results rather than
+ * aggregate them (see pagerd.c).
+ *
+ * Every page ends with its position: the partition, row group and row
+ * to go on from, and the rows returned so far, against a pin of the
+ * manifest prefix the first page saw. The client sends it back for the
+ * next page. A server still positioned there (the usual case: it just
+ * sent that page) carries on from its open scan without rereading the
+ * manifest, so a page costs only the rows it reads; each partition is
+ * checked against the pin as it's opened. Otherwise the manifest is
+ * reread and the scan replanned and reopened at the row group, which
+ * costs at most one group more. Segments published
+ * after the first page aren't seen. If a pinned segment was re-sent, the
+ * cursor can't resume and has to start over.
+ *
+ * The structs go over the wire as-is, as with shardd.
+*/
+
+#define CURSOR_PAGEMAX 256
+
+/* Columns a cursor returns; its filters need QUERY_FILTER_COLS as well. */
+#define CURSOR_COLS (QUERY_FILTER_COLS | COL_BIT(COL_ORDERID)		\
+	| COL_BIT(COL_STATIONID) | COL_BIT(COL_PRICE)			\
+	| COL_BIT(COL_VOLMIN) | COL_BIT(COL_VOLREM)			\
+	| COL_BIT(COL_ISSUED) | COL_BIT(COL_DURATION) | COL_BIT(COL_RANGE))
+
+struct cursor_row {
+	uint64_t orderID;
+	uint64_t price;
+	uint32_t regionID;
+	uint32_t stationID;
+	uint32_t typeID;
+	uint32_t volMin;
+	uint32_t volRem;
+	uint32_t issued;
+	uint32_t rtime;
+	uint16_t duration;
+	int8_t range;
+	uint8_t bid;
+	uint32_t pad;
+};
+
+/* Where a page stopped. All zero asks for the first page. */
+struct cursor_pos {
+	uint64_t pin;		/* Of the first nparts partitions. */
+	uint32_t nparts;
+	uint32_t part;		/* Next partition to read. */
+	uint64_t group;		/* Next row group of it. */
+	uint32_t row;		/* Next row of that group. */
+	uint32_t done;		/* Nonzero once every row was returned. */
+	uint64_t returned;	/* Rows in the pages before. */
+};
+
+struct cursor_req {
+	struct query q;		/* The same for every page. */
+	uint32_t limit;		/* Rows wanted, up to CURSOR_PAGEMAX. */
+	struct cursor_pos pos;
+};
+
+/* Reply codes. */
+#define CURSOR_OK 0
+#define CURSOR_FAILED 1
+#define CURSOR_STALE 2	/* A pinned segment changed; start over. */
+
+struct cursor_reply {
+	int32_t rc;
+	uint32_t n;
+	struct cursor_pos pos;	/* Of the next page. */
+	struct cursor_row rows[CURSOR_PAGEMAX];
+};
+
+/* A server's open cursor. */
+struct cursor {
+	const char *root;
+	struct arena *a;	/* Scan buffers, reset per partition. */
+	struct store store;	/* As pinned. */
+	uint64_t *ino;		/* Which copy of each partition was pinned. */
+	struct query q;
+	struct cursor_pos pos;
+	int open;		/* scan is positioned at pos. */
+	int have;		/* b holds pos.group. */
+	struct scan scan;
+	struct scan_batch b;
+};
+
+void
+cursor_init(struct cursor *c, const char *root, struct arena *a);
+
+/* Answers req into r, from c's open scan if it's where req left off. */
+void
+cursor_page(struct cursor *c, const struct cursor_req *req,
+    struct cursor_reply *r);
+
+void
+cursor_free(struct cursor *c);
+
+#endif
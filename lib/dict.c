@@ -0,0 +1,239 @@
+#include "dict.h"
+
+#include <stdio.h>	/* fopen(), printf() */
+#include <string.h>	/* memset() */
+#include <fcntl.h>	/* open() */
+#include <unistd.h>	/* close() */
+#include <sys/file.h>	/* flock() */
+#include <sys/stat.h>	/* stat() */
+#include <assert.h>	/* assert() */
+
+#include "mem.h"
+#include "scan.h"
+
+int
+dict_lock(const char *root)
+{
+	char path[STORE_PATHLEN];
+	int fd;
+	{ /* Preconditions */
+		assert(root != NULL);
+	}
+	snprintf(path, sizeof(path), "%s/DICT.lock", root);
+	if ((fd = open(path, O_RDWR | O_CREAT, 0644)) == -1) {
+		printf("Failed to open %s\n", path);
+		return -1;
+	}
+	if (flock(fd, LOCK_EX)) {
+		printf("Failed to lock %s\n", path);
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+void
+dict_unlock(int fd)
+{
+	close(fd); /* Drops the lock. */
+}
+
+enum eve_col
+dict_dense_col(enum eve_col col)
+{
+	switch (col) {
+	case COL_REGIONID:
+		return COL_REGIONIDX;
+	case COL_SYSTEMID:
+		return COL_SYSTEMIDX;
+	case COL_STATIONID:
+		return COL_STATIONIDX;
+	default:
+		return NALLCOLS;
+	}
+}
+
+static uint32_t
+slot_of(uint32_t id, uint32_t nslots)
+{
+	return (uint32_t)(id * 0x9e3779b1u) & (nslots - 1);
+}
+
+/* Rebuilds the sparse to dense table for at least n IDs. */
+static int
+rehash(struct dict *d, uint32_t n)
+{
+	uint32_t nslots = 64, i, s;
+	while (nslots < 2 * n) {
+		nslots *= 2;
+	}
+	mem_free(d->slots, sizeof(*d->slots) * d->nslots, MEM_INDEX);
+	d->slots = mem_alloc(sizeof(*d->slots) * nslots, MEM_INDEX);
+	if (d->slots == NULL) {
+		d->nslots = 0;
+		return 1;
+	}
+	memset(d->slots, 0, sizeof(*d->slots) * nslots);
+	d->nslots = nslots;
+	for (i = 0; i < d->n; ++i) {
+		for (s = slot_of(d->ids[i], nslots); d->slots[s] != 0;
+		    s = (s + 1) & (nslots - 1));
+		d->slots[s] = i + 1;
+	}
+	return 0;
+}
+
+int
+dict_load(struct dict *d, const char *root, enum eve_col col)
+{
+	char path[STORE_PATHLEN];
+	struct stat st;
+	FILE *f;
+	{ /* Preconditions */
+		assert(d != NULL);
+		assert(root != NULL);
+		assert(dict_dense_col(col) != NALLCOLS);
+	}
+	d->col = col;
+	d->n = d->cap = d->nslots = 0;
+	d->ids = d->slots = NULL;
+	snprintf(path, sizeof(path), "%s/DICT.%s", root, eve_col_names[col]);
+	if (stat(path, &st) == 0 && st.st_size > 0) {
+		d->cap = (uint32_t)(st.st_size / sizeof(*d->ids));
+		d->ids = mem_alloc(sizeof(*d->ids) * d->cap, MEM_INDEX);
+		if (d->ids == NULL || (f = fopen(path, "rb")) == NULL) {
+			printf("Failed to read %s\n", path);
+			dict_free(d);
+			return 1;
+		}
+		d->n = (uint32_t)fread(d->ids, sizeof(*d->ids), d->cap, f);
+		fclose(f);
+	}
+	if (rehash(d, d->n)) {
+		dict_free(d);
+		return 1;
+	}
+	return 0;
+}
+
+void
+dict_free(struct dict *d)
+{
+	mem_free(d->ids, sizeof(*d->ids) * d->cap, MEM_INDEX);
+	mem_free(d->slots, sizeof(*d->slots) * d->nslots, MEM_INDEX);
+	d->ids = d->slots = NULL;
+	d->n = d->cap = d->nslots = 0;
+	return;
+}
+
+uint32_t
+dict_lookup(const struct dict *d, uint32_t id)
+{
+	uint32_t s;
+	for (s = slot_of(id, d->nslots); d->slots[s] != 0;
+	    s = (s + 1) & (d->nslots - 1)) {
+		if (d->ids[d->slots[s] - 1] == id) {
+			return d->slots[s] - 1;
+		}
+	}
+	return DICT_NONE;
+}
+
+uint32_t
+dict_add(struct dict *d, uint32_t id)
+{
+	uint32_t s, dense = dict_lookup(d, id);
+	if (dense != DICT_NONE) {
+		return dense;
+	}
+	if (d->n == d->cap) {
+		const uint32_t cap = d->cap ? 2 * d->cap : 1024;
+		uint32_t *ids = mem_realloc(d->ids, sizeof(*ids) * d->cap,
+		    sizeof(*ids) * cap, MEM_INDEX);
+		if (ids == NULL) {
+			return DICT_NONE;
+		}
+		d->ids = ids;
+		d->cap = cap;
+	}
+	if (2 * (d->n + 1) > d->nslots && rehash(d, d->n + 1)) {
+		return DICT_NONE;
+	}
+	d->ids[d->n] = id;
+	for (s = slot_of(id, d->nslots); d->slots[s] != 0;
+	    s = (s + 1) & (d->nslots - 1));
+	d->slots[s] = ++d->n;
+	return d->n - 1;
+}
+
+int
+dict_save(const struct dict *d, const char *root)
+{
+	char path[STORE_PATHLEN], tmp[STORE_PATHLEN];
+	FILE *f;
+	int rc = 0;
+	snprintf(path, sizeof(path), "%s/DICT.%s", root,
+	    eve_col_names[d->col]);
+	snprintf(tmp, sizeof(tmp), "%s/DICT.%s.tmp", root,
+	    eve_col_names[d->col]);
+	if (!(f = fopen(tmp, "wb"))) {
+		printf("Failed to open %s\n", tmp);
+		return 1;
+	}
+	if (fwrite(d->ids, sizeof(*d->ids), d->n, f) != d->n) {
+		rc = 1;
+	}
+	if (fclose(f) || rc || rename(tmp, path)) {
+		printf("Failed to write %s\n", path);
+		remove(tmp);
+		return 1;
+	}
+	return 0;
+}
+
+int
+dict_encode(struct dict *d, const struct partition *p, struct arena *a)
+{
+	const enum eve_col dense = dict_dense_col(d->col);
+	char path[STORE_PATHLEN], tmp[STORE_PATHLEN];
+	struct scan scan;
+	struct scan_batch b;
+	uint32_t *out;
+	size_t i;
+	FILE *f;
+	int rc, err = 0;
+	{ /* Preconditions */
+		assert(d != NULL);
+		assert(p != NULL);
+		assert(a != NULL);
+	}
+	if ((out = arena_alloc(a, SCAN_GROUP * sizeof(*out))) == NULL
+	    || scan_open(&scan, p, COL_BIT(d->col), NULL, 0, a)) {
+		return 1;
+	}
+	store_colpath(p, dense, path);
+	store_path(p, "dense.tmp", tmp);
+	if (!(f = fopen(tmp, "wb"))) {
+		printf("Failed to open %s\n", tmp);
+		scan_close(&scan);
+		return 1;
+	}
+	while (!err && (rc = scan_next(&scan, &b)) == 0) {
+		const uint32_t *sparse = b.col[d->col];
+		for (i = 0; i < b.n; ++i) {
+			if ((out[i] = dict_add(d, sparse[i])) == DICT_NONE) {
+				err = 1;
+			}
+		}
+		if (fwrite(out, sizeof(*out), b.n, f) != b.n) {
+			err = 1;
+		}
+	}
+	scan_close(&scan);
+	if (fclose(f) || err || rc < 0 || rename(tmp, path)) {
+		printf("Failed to write %s\n", path);
+		remove(tmp);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,75 @@
+#ifndef DICT_H_
+#define DICT_H_
+
+#include <stdint.h>	/* uint*_t */
+
+#include "arena.h"	/* struct arena */
+#include "eve_txn.h"	/* enum eve_col */
+#include "store.h"	/* struct partition */
+
+/*
+ * Dense IDs for the location columns. Region, system and station IDs are
+ * sparse 8 digit numbers; a store keeps one dictionary per column in
+ * root/DICT.<column> (the sparse IDs in dense order) and, next to each
+ * partition's sparse column, a dense one holding 0..n-1 (COL_REGIONIDX
+ * and friends). Grouping by a dense column is indexing a flat array of n
+ * entries instead of hashing.
+ *
+ * Dictionaries only ever grow, in ingest order, so a dense ID never
+ * changes meaning and every published partition stays valid as new ones
+ * add IDs. dumper.sh encodes a segment before publishing it.
+*/
+
+#define DICT_NONE UINT32_MAX
+
+struct dict {
+	enum eve_col col;	/* Sparse column. */
+	uint32_t n;
+	uint32_t cap;
+	uint32_t *ids;		/* Dense to sparse. */
+	uint32_t *slots;	/* Sparse to dense + 1, 0 when empty. */
+	uint32_t nslots;	/* A power of two, over twice n. */
+};
+
+/*
+ * Takes root's exclusive dictionary lock (root/DICT.lock), waiting for
+ * any other holder, for a load, encode and save that must not interleave
+ * with another's. Returns a descriptor for dict_unlock(), or -1.
+*/
+int
+dict_lock(const char *root);
+
+void
+dict_unlock(int fd);
+
+/* Dense column of sparse column col, or NALLCOLS if it has none. */
+enum eve_col
+dict_dense_col(enum eve_col col);
+
+/* Reads root's dictionary for col; none yet is an empty one. */
+int
+dict_load(struct dict *d, const char *root, enum eve_col col);
+
+void
+dict_free(struct dict *d);
+
+/* Returns id's dense ID, or DICT_NONE. */
+uint32_t
+dict_lookup(const struct dict *d, uint32_t id);
+
+/* Returns id's dense ID, adding it if it's new, or DICT_NONE on failure. */
+uint32_t
+dict_add(struct dict *d, uint32_t id);
+
+/* Writes d back to root. Returns 0 on success. */
+int
+dict_save(const struct dict *d, const char *root);
+
+/*
+ * Writes p's dense column, adding new IDs to d. Returns 0 on success.
+ * Save d before publishing p.
+*/
+int
+dict_encode(struct dict *d, const struct partition *p, struct arena *a);
+
+#endif
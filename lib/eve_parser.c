@@ -169,7 +169,7 @@ parse_duration(const char** const s)
 static struct eve_txn
 parse_raw_txn(const char* str)
 {
-	struct eve_txn txn;
+	struct eve_txn txn = {0}; /* Defined even if we give up early. */
 	{ /* Preconditions */
 		assert(str != NULL);
 	}
@@ -212,27 +212,26 @@ parse_raw_txn(const char* str)
 	return txn;
 }
 
-/* Converts a pacific timestamp to UTC. Faster than mktime() by a lot. */
-static uint32_t
-pt_to_utc(const uint32_t pacificTime)
+/*
+ * Dumps before D20071001 (see init_eve_txn_parser()) have Pacific times,
+ * converted with the table of lib/tz.h. Faster than mktime() by a lot.
+*/
+#define PACIFIC "America/Los_Angeles"
+static const struct tz_zone *pacific;
+
+/* As has_bad_value(), for the checks that don't need times in UTC. */
+static int
+has_bad_field(const struct eve_txn* const txn)
 {
-	/*
-	 * YYYY-MM-DD-HH in PT (These are the date-times where daylight savings
-	 * time apparently switches (according to tzdump on my machine) within
-	 * the range of dates that we care about).
-	*/
-	#define D2006040203 1144033200
-	#define D2006102901 1162256400
-	#define D2007031103 1173754800
-	if (pacificTime < D2006040203) {
-		return pacificTime + 8 * HR_SECONDS;
-	} else if (pacificTime < D2006102901) {
-		return pacificTime + 7 * HR_SECONDS;
-	} else if (pacificTime < D2007031103) {
-		return pacificTime + 8 * HR_SECONDS;
-	} else { /* Data is UTC after this time period, so else() is fine. */
-		return pacificTime + 7 * HR_SECONDS;
+	{ /* Preconditions */
+		assert(txn != NULL);
 	}
+	if (txn->bid > 1) {
+		return 2;
+	} else if (txn->range == -2) {
+		return 3;
+	}
+	return 0;
 }
 
 /* Returns 0 if no badval, type of bad value otherwise. */
@@ -242,14 +241,10 @@ has_bad_value(const struct eve_txn* const txn)
 	{ /* Preconditions */
 		assert(txn != NULL);
 	}
-	if (txn->issued > txn->rtime) {
-		return 1;
-	} else if (txn->bid > 1) {
-		return 2;
-	} else if (txn->range == -2) {
-		return 3;
+	if (txn->issued > txn->rtime || txn->rtime == TZ_NONE) {
+		return 1; /* TZ_NONE: past the zone table. */
 	}
-	return 0;
+	return has_bad_field(txn);
 }
 
 /* Check formats.txt for specifics of each format. */
@@ -272,11 +267,23 @@ parse_txn_pt(const char* str, struct eve_txn *txn)
 		assert(txn != NULL);
 	}
 	*txn = parse_raw_txn(str);
-	txn->issued = pt_to_utc(txn->issued);
-	txn->rtime = pt_to_utc(txn->rtime);
+	txn->issued = tz_to_utc(pacific, txn->issued);
+	txn->rtime = tz_to_utc(pacific, txn->rtime);
 	return has_bad_value(txn);
 }
 
+/* Leaves the times local, for eve_txn_to_utc() to convert. */
+static int
+parse_txn_local(const char* str, struct eve_txn *txn)
+{
+	{ /* Preconditions */
+		assert(str != NULL);
+		assert(txn != NULL);
+	}
+	*txn = parse_raw_txn(str);
+	return has_bad_field(txn);
+}
+
 static int
 parse_txn_pt_bo(const char* const str, struct eve_txn* txn)
 {
@@ -291,17 +298,32 @@ parse_txn_pt_bo(const char* const str, struct eve_txn* txn)
 	 * Similarly, the range for sell orders (0) is always 0, so:
 	*/
 	txn->range = -1 * txn->bid;
-	txn->issued = pt_to_utc(txn->issued);
-	txn->rtime = pt_to_utc(txn->rtime);
+	txn->issued = tz_to_utc(pacific, txn->issued);
+	txn->rtime = tz_to_utc(pacific, txn->rtime);
 	return has_bad_value(txn);
 }
 
+static int
+parse_txn_bo_local(const char* const str, struct eve_txn* txn)
+{
+	{ /* Preconditions */
+		assert(str != NULL);
+		assert(txn != NULL);
+	}
+	*txn = parse_raw_txn(str);
+	txn->range = (int8_t)(-1 * txn->bid); /* See parse_txn_pt_bo(). */
+	return has_bad_field(txn);
+}
+
+#define D20070101 1167609600 /* Consult formats.txt for dates. */
+#define D20071001 1191369600
+
 eve_txn_parser
 init_eve_txn_parser(uint32_t year, uint32_t month, uint32_t day)
 {
-	#define D20070101 1167609600 /* Consult formats.txt for dates. */
-	#define D20071001 1191369600
 	const uint64_t edelta = ejday(year, month, day); /*seconds from epoch*/
+	pacific = tz_find(PACIFIC);
+	assert(pacific != NULL);
 	if (edelta < D20070101) {
 		return parse_txn_pt_bo;
 	} else if (edelta < D20071001) {
@@ -310,3 +332,52 @@ init_eve_txn_parser(uint32_t year, uint32_t month, uint32_t day)
 		return parse_txn;
 	}
 }
+
+eve_txn_parser
+init_eve_txn_parser_local(uint32_t year, uint32_t month, uint32_t day,
+    const struct tz_zone **zone)
+{
+	const uint64_t edelta = ejday(year, month, day); /*seconds from epoch*/
+	{ /* Preconditions */
+		assert(zone != NULL);
+	}
+	*zone = NULL;
+	if (edelta >= D20071001) {
+		return parse_txn;
+	}
+	*zone = tz_find(PACIFIC);
+	assert(*zone != NULL);
+	return (edelta < D20070101) ? parse_txn_bo_local : parse_txn_local;
+}
+
+size_t
+eve_txn_to_utc(struct eve_txn *txn, size_t n, const struct tz_zone *zone,
+    uint32_t *scratch, void (*bad)(const struct eve_txn *txn))
+{
+	uint32_t *const issued = scratch, *const rtime = scratch + n;
+	size_t i, use = 0;
+	{ /* Preconditions */
+		assert(txn != NULL || n == 0);
+		assert(zone != NULL);
+		assert(scratch != NULL);
+	}
+	for (i = 0; i < n; ++i) {
+		issued[i] = txn[i].issued;
+		rtime[i] = txn[i].rtime;
+	}
+	tz_to_utc_batch(zone, scratch, 2 * n);
+	for (i = 0; i < n; ++i) {
+		txn[use] = txn[i];
+		txn[use].issued = issued[i];
+		txn[use].rtime = rtime[i];
+		if (issued[i] > rtime[i] || rtime[i] == TZ_NONE) {
+			/* As has_bad_value() would. */
+			if (bad != NULL) {
+				bad(&txn[use]);
+			}
+			continue;
+		}
+		use++;
+	}
+	return use;
+}
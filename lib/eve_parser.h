@@ -6,9 +6,29 @@
 #include <stdint.h> /* uint*_t */
 #include <ctype.h>  /* isdigit() */
 #include "eve_txn.h" /* struct eve_txn */
+#include "tz.h"      /* struct tz_zone */
 
 typedef int (*eve_txn_parser)(const char *str, struct eve_txn *rec);
 
 eve_txn_parser init_eve_txn_parser(uint32_t year, uint32_t mon, uint32_t day);
 
+/*
+ * As init_eve_txn_parser(), but the parser leaves times in the file's zone,
+ * *zone, and doesn't check their order; eve_txn_to_utc() does both for a
+ * batch at a time. *zone is NULL if the file is in UTC already.
+*/
+eve_txn_parser init_eve_txn_parser_local(uint32_t year, uint32_t mon,
+    uint32_t day, const struct tz_zone **zone);
+
+/*
+ * Converts the times of n txns from zone to UTC, and drops those issued
+ * after they were reported or past the zone's table (see lib/tz.h),
+ * passing each to bad (if not NULL) first.
+ * scratch holds 2n times. Returns the txns kept, in order at the start of
+ * txn.
+*/
+size_t eve_txn_to_utc(struct eve_txn *txn, size_t n,
+    const struct tz_zone *zone, uint32_t *scratch,
+    void (*bad)(const struct eve_txn *txn));
+
 #endif
@@ -1,5 +1,19 @@
 #include "eve_txn.h"
 
+const char* const eve_col_names[NALLCOLS] = { "orderid", "regionid",
+	"systemid", "stationid", "typeid", "bid", "price", "volmin", "volrem",
+	"volent", "issued", "duration", "range", "reportedby", "reportedtime",
+	"regionid.dense", "systemid.dense", "stationid.dense"
+};
+
+#define S(f) sizeof(((struct eve_txn *)0)->f)
+const unsigned int eve_col_sizes[NALLCOLS] = { S(orderID), S(regionID),
+	S(systemID), S(stationID), S(typeID), S(bid), S(price), S(volMin),
+	S(volRem), S(volEnt), S(issued), S(duration), S(range), S(reportedby),
+	S(rtime), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t)
+};
+#undef S
+
 void
 print_eve_txn(struct eve_txn *t)
 {
@@ -40,4 +40,34 @@ struct eve_txn {
 };
 void print_eve_txn(struct eve_txn *t);
 
+/* Columns of the store, in the converter's output (input) order. */
+enum eve_col {
+	COL_ORDERID = 0,
+	COL_REGIONID,
+	COL_SYSTEMID,
+	COL_STATIONID,
+	COL_TYPEID,
+	COL_BID,
+	COL_PRICE,
+	COL_VOLMIN,
+	COL_VOLREM,
+	COL_VOLENT,
+	COL_ISSUED,
+	COL_DURATION,
+	COL_RANGE,
+	COL_REPORTEDBY,
+	COL_RTIME,
+	NCOLS,
+	/* Dense IDs (see dict.h), written after the converter has run. */
+	COL_REGIONIDX = NCOLS,
+	COL_SYSTEMIDX,
+	COL_STATIONIDX,
+	NALLCOLS
+};
+
+#define COL_BIT(c) (1u << (c))
+
+extern const char* const eve_col_names[NALLCOLS];  /* Column file names. */
+extern const unsigned int eve_col_sizes[NALLCOLS]; /* Bytes per value. */
+
 #endif
@@ -0,0 +1,298 @@
+#include "gzindex.h"
+
+#include <stdio.h>	/* fopen(), rename(), snprintf() */
+#include <string.h>	/* memcpy(), memset() */
+#include <limits.h>	/* PATH_MAX */
+#include <unistd.h>	/* pread() */
+#include <sys/stat.h>	/* fstat() */
+#include <assert.h>	/* assert() */
+#include <zlib.h>
+
+#include "mem.h"
+
+#define CHUNK 16384
+#define GZI_MAGIC "EVEGZI1"
+
+/* Records an access point. window is the circular output buffer. */
+static int
+add_point(struct gzindex *idx, int bits, int64_t in, int64_t out,
+    unsigned int left, const unsigned char *window)
+{
+	struct gzpoint *next;
+	if (idx->have == idx->size) {
+		const int size = idx->size ? idx->size * 2 : 8;
+		next = mem_realloc(idx->list, sizeof(*next) * (size_t)idx->size,
+		    sizeof(*next) * (size_t)size, MEM_INDEX);
+		if (next == NULL) {
+			return Z_MEM_ERROR;
+		}
+		idx->list = next;
+		idx->size = size;
+	}
+	next = idx->list + idx->have++;
+	next->bits = bits;
+	next->in = in;
+	next->out = out;
+	/* Unroll the circular buffer, oldest byte first. */
+	if (left) {
+		memcpy(next->window, window + GZI_WINSIZE - left, left);
+	}
+	if (left < GZI_WINSIZE) {
+		memcpy(next->window + left, window, GZI_WINSIZE - left);
+	}
+	return Z_OK;
+}
+
+int
+gzindex_build(int fd, off_t span, struct gzindex *idx)
+{
+	int ret;
+	int64_t totin = 0, totout = 0, last = 0;
+	off_t pos = 0;
+	ssize_t rb;
+	z_stream strm;
+	unsigned char input[CHUNK];
+	unsigned char window[GZI_WINSIZE];
+	struct stat st;
+	{ /* Preconditions */
+		assert(fd >= 0);
+		assert(span > 0);
+		assert(idx != NULL);
+	}
+	memset(idx, 0, sizeof(*idx));
+	/* The first point is saved with the window it starts from: none. */
+	memset(window, 0, sizeof(window));
+	if (fstat(fd, &st)) {
+		return Z_ERRNO;
+	}
+	idx->gzsize = st.st_size;
+	idx->mtime = st.st_mtime;
+	memset(&strm, 0, sizeof(strm));
+	if ((ret = inflateInit2(&strm, 47)) != Z_OK) { /* gzip/zlib header */
+		return ret;
+	}
+	strm.avail_out = 0;
+	do {
+		if ((rb = pread(fd, input, CHUNK, pos)) <= 0) {
+			ret = (rb < 0) ? Z_ERRNO : Z_DATA_ERROR; /* Truncated */
+			goto fail;
+		}
+		pos += rb;
+		strm.avail_in = (unsigned int)rb;
+		strm.next_in = input;
+		do {
+			if (strm.avail_out == 0) {
+				strm.avail_out = GZI_WINSIZE;
+				strm.next_out = window;
+			}
+			/* Z_BLOCK stops at every deflate block boundary. */
+			totin += strm.avail_in;
+			totout += strm.avail_out;
+			ret = inflate(&strm, Z_BLOCK);
+			totin -= strm.avail_in;
+			totout -= strm.avail_out;
+			if (ret == Z_NEED_DICT) {
+				ret = Z_DATA_ERROR;
+			}
+			if (ret == Z_MEM_ERROR || ret == Z_DATA_ERROR) {
+				goto fail;
+			}
+			if (ret == Z_STREAM_END) {
+				break;
+			}
+			/* At the end of a header or non-last block? */
+			if ((strm.data_type & 128) && !(strm.data_type & 64)
+			    && (totout == 0 || totout - last > span)) {
+				ret = add_point(idx, strm.data_type & 7, totin,
+				    totout, strm.avail_out, window);
+				if (ret != Z_OK) {
+					goto fail;
+				}
+				last = totout;
+			}
+		} while (strm.avail_in != 0);
+	} while (ret != Z_STREAM_END);
+	inflateEnd(&strm);
+	idx->length = totout;
+	return 0;
+
+fail:
+	inflateEnd(&strm);
+	gzindex_free(idx);
+	return ret;
+}
+
+void
+gzindex_free(struct gzindex *idx)
+{
+	mem_free(idx->list, sizeof(*idx->list) * (size_t)idx->size, MEM_INDEX);
+	idx->list = NULL;
+	idx->have = idx->size = 0;
+	return;
+}
+
+int
+gzindex_save(const struct gzindex *idx, const char *path)
+{
+	char tmp[PATH_MAX];
+	FILE *f;
+	int i, rc = 0;
+	if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)
+	    || !(f = fopen(tmp, "wb"))) {
+		return 1;
+	}
+	rc |= fwrite(GZI_MAGIC, sizeof(GZI_MAGIC), 1, f) != 1;
+	rc |= fwrite(&idx->length, sizeof(idx->length), 1, f) != 1;
+	rc |= fwrite(&idx->gzsize, sizeof(idx->gzsize), 1, f) != 1;
+	rc |= fwrite(&idx->mtime, sizeof(idx->mtime), 1, f) != 1;
+	rc |= fwrite(&idx->have, sizeof(idx->have), 1, f) != 1;
+	for (i = 0; i < idx->have && !rc; ++i) {
+		const struct gzpoint *p = idx->list + i;
+		rc |= fwrite(&p->out, sizeof(p->out), 1, f) != 1;
+		rc |= fwrite(&p->in, sizeof(p->in), 1, f) != 1;
+		rc |= fwrite(&p->bits, sizeof(p->bits), 1, f) != 1;
+		rc |= fwrite(p->window, GZI_WINSIZE, 1, f) != 1;
+	}
+	rc |= fclose(f) != 0;
+	/* A newer index is trusted over its dump; never leave half of one. */
+	if (rc || rename(tmp, path)) {
+		remove(tmp);
+		return 1;
+	}
+	return 0;
+}
+
+int
+gzindex_load(struct gzindex *idx, const char *path, int fd)
+{
+	FILE *f;
+	int i, rc = 0;
+	char magic[sizeof(GZI_MAGIC)];
+	struct stat st;
+	memset(idx, 0, sizeof(*idx));
+	if (fstat(fd, &st) || !(f = fopen(path, "rb"))) {
+		return 1;
+	}
+	rc |= fread(magic, sizeof(magic), 1, f) != 1;
+	rc |= memcmp(magic, GZI_MAGIC, sizeof(magic)) != 0;
+	rc |= fread(&idx->length, sizeof(idx->length), 1, f) != 1;
+	rc |= fread(&idx->gzsize, sizeof(idx->gzsize), 1, f) != 1;
+	rc |= fread(&idx->mtime, sizeof(idx->mtime), 1, f) != 1;
+	rc |= fread(&idx->have, sizeof(idx->have), 1, f) != 1;
+	rc |= idx->gzsize != st.st_size || idx->mtime != st.st_mtime;
+	rc |= idx->have <= 0;
+	if (!rc) {
+		idx->size = idx->have;
+		idx->list = mem_alloc(sizeof(*idx->list) * (size_t)idx->size,
+		    MEM_INDEX);
+		rc |= idx->list == NULL;
+	}
+	for (i = 0; i < idx->have && !rc; ++i) {
+		struct gzpoint *p = idx->list + i;
+		rc |= fread(&p->out, sizeof(p->out), 1, f) != 1;
+		rc |= fread(&p->in, sizeof(p->in), 1, f) != 1;
+		rc |= fread(&p->bits, sizeof(p->bits), 1, f) != 1;
+		rc |= fread(p->window, GZI_WINSIZE, 1, f) != 1;
+	}
+	fclose(f);
+	if (rc) {
+		gzindex_free(idx);
+	}
+	return rc;
+}
+
+ssize_t
+gzindex_extract(int fd, const struct gzindex *idx, off_t offset,
+    unsigned char *buf, size_t len)
+{
+	int ret, skip = 1;
+	off_t pos;
+	ssize_t rb;
+	z_stream strm;
+	const struct gzpoint *here;
+	unsigned char input[CHUNK];
+	unsigned char discard[GZI_WINSIZE];
+	{ /* Preconditions */
+		assert(idx != NULL);
+		assert(idx->have > 0);
+		assert(len <= UINT32_MAX);
+	}
+	if (len == 0 || offset < 0 || offset >= idx->length) {
+		return 0;
+	}
+	/* Last access point at or before offset. */
+	{
+		int lo = 0, hi = idx->have - 1;
+		while (lo < hi) {
+			const int mid = (lo + hi + 1) / 2;
+			if (idx->list[mid].out <= offset) {
+				lo = mid;
+			} else {
+				hi = mid - 1;
+			}
+		}
+		here = idx->list + lo;
+	}
+	memset(&strm, 0, sizeof(strm));
+	if ((ret = inflateInit2(&strm, -15)) != Z_OK) { /* raw inflate */
+		return ret;
+	}
+	pos = here->in - (here->bits ? 1 : 0);
+	if (here->bits) { /* Point starts mid-byte. */
+		unsigned char c;
+		if (pread(fd, &c, 1, pos) != 1) {
+			ret = Z_ERRNO;
+			goto out;
+		}
+		pos++;
+		inflatePrime(&strm, here->bits, c >> (8 - here->bits));
+	}
+	inflateSetDictionary(&strm, here->window, GZI_WINSIZE);
+	offset -= here->out;
+	do {
+		/* Discard output up to offset, then fill buf. */
+		if (offset == 0 && skip) {
+			strm.avail_out = (unsigned int)len;
+			strm.next_out = buf;
+			skip = 0;
+		}
+		if (offset > GZI_WINSIZE) {
+			strm.avail_out = GZI_WINSIZE;
+			strm.next_out = discard;
+			offset -= GZI_WINSIZE;
+		} else if (offset > 0) {
+			strm.avail_out = (unsigned int)offset;
+			strm.next_out = discard;
+			offset = 0;
+		}
+		do {
+			if (strm.avail_in == 0) {
+				if ((rb = pread(fd, input, CHUNK, pos)) <= 0) {
+					ret = rb < 0 ? Z_ERRNO : Z_DATA_ERROR;
+					goto out;
+				}
+				pos += rb;
+				strm.avail_in = (unsigned int)rb;
+				strm.next_in = input;
+			}
+			ret = inflate(&strm, Z_NO_FLUSH);
+			if (ret == Z_NEED_DICT) {
+				ret = Z_DATA_ERROR;
+			}
+			if (ret == Z_MEM_ERROR || ret == Z_DATA_ERROR) {
+				goto out;
+			}
+			if (ret == Z_STREAM_END) {
+				break;
+			}
+		} while (strm.avail_out != 0);
+	} while (skip && ret != Z_STREAM_END);
+	ret = 0;
+
+out:
+	inflateEnd(&strm);
+	if (ret < 0) {
+		return ret;
+	}
+	return skip ? 0 : (ssize_t)(len - strm.avail_out);
+}
@@ -0,0 +1,68 @@
+#ifndef GZINDEX_H_
+#define GZINDEX_H_
+
+#include <stdint.h>	/* uint*_t */
+#include <sys/types.h>	/* off_t, ssize_t */
+
+/*
+ * Random access into .gz files, after zlib's examples/zran.c.
+ *
+ * gzindex_build() inflates the file once and records an access point
+ * roughly every span bytes of output: where the deflate block starts in
+ * the compressed file and the 32 KiB of output that precedes it. From any
+ * point, gzindex_extract() can start inflating without reading anything
+ * before it, so different regions of one file can be decompressed on
+ * different cores. The index is kept in a "<file>.gzi" sidecar.
+ *
+ * Only single member gzip files are supported, which is what dumps are.
+*/
+
+#define GZI_WINSIZE 32768
+
+struct gzpoint {
+	int64_t out;	/* Uncompressed offset of the point. */
+	int64_t in;	/* Compressed offset of the first full byte. */
+	int32_t bits;	/* Bits of the byte before in that belong here. */
+	unsigned char window[GZI_WINSIZE]; /* Preceding output. */
+};
+
+struct gzindex {
+	int64_t length;		/* Uncompressed size of the whole file. */
+	int64_t gzsize;		/* Compressed size, to detect stale sidecars. */
+	int64_t mtime;
+	int have;
+	int size;
+	struct gzpoint *list;
+};
+
+/* Returns 0 on success, a zlib error (< 0) otherwise. */
+int
+gzindex_build(int fd, off_t span, struct gzindex *idx);
+
+void
+gzindex_free(struct gzindex *idx);
+
+/*
+ * Writes idx to path.tmp and renames it over path, so a crash never
+ * leaves a partial sidecar. Returns 0 on success, 1 on I/O errors.
+*/
+int
+gzindex_save(const struct gzindex *idx, const char *path);
+
+/*
+ * Loads the sidecar at path and checks it against the .gz file open on fd.
+ * Returns 0 on success, 1 if it's missing, corrupt, or stale.
+*/
+int
+gzindex_load(struct gzindex *idx, const char *path, int fd);
+
+/*
+ * Inflates len bytes starting at uncompressed offset into buf. Uses
+ * pread() only, so threads may share fd. Returns the number of bytes
+ * read (less than len at the end of the file), or a zlib error (< 0).
+*/
+ssize_t
+gzindex_extract(int fd, const struct gzindex *idx, off_t offset,
+    unsigned char *buf, size_t len);
+
+#endif
@@ -0,0 +1,363 @@
+#include "hashagg.h"
+
+#include <stdio.h>	/* printf(), snprintf() */
+#include <stdlib.h>	/* malloc(), getenv(), mkstemp() */
+#include <string.h>	/* memcpy(), memset() */
+#include <unistd.h>	/* read(), lseek(), unlink() */
+#include <assert.h>	/* assert() */
+
+#include "checksum.h"
+#include "mem.h"
+
+#define KEYSIZE sizeof(uint64_t)
+
+/* splitmix64 finalizer, seeded per level so partitions split again. */
+static uint64_t
+hash(uint64_t key, unsigned int depth)
+{
+	uint64_t x = key + 0x9e3779b97f4a7c15ULL * (depth + 1);
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+/* Spill queue buffers, all HASHAGG_FANOUT of them. */
+static size_t
+spill_bytes(unsigned int entSize)
+{
+	return HASHAGG_FANOUT * (PAGESIZE + (size_t)queue_block_count(entSize)
+	    * entSize + 2 * ARENA_ALIGN);
+}
+
+/* Buffers for reading one spill file back. */
+static size_t
+read_bytes(unsigned int entSize)
+{
+	return PAGESIZE + (size_t)queue_block_count(entSize) * entSize;
+}
+
+/* extra is memory held on top of our tables and buffers for a moment. */
+static void
+note_peak(struct hashagg *h, size_t extra)
+{
+	size_t use = h->base + h->cap * (h->entSize + 1) + h->entSize + extra;
+	if (h->spilling) {
+		use += h->arena.cap;
+	}
+	if (use > h->stats.peak) {
+		h->stats.peak = use;
+	}
+	return;
+}
+
+/* base is memory our callers hold while we run, out of the same budget. */
+static int
+init_level(struct hashagg *h, unsigned int valSize, hashagg_merge merge,
+    size_t budget, unsigned int depth, size_t base)
+{
+	const unsigned int entSize = (KEYSIZE + valSize + 7) & ~7u;
+	const size_t reserve = base + spill_bytes(entSize) + entSize;
+	const size_t avail = budget > reserve ? budget - reserve : 0;
+	unsigned int i;
+	h->valSize = valSize;
+	h->entSize = entSize;
+	h->merge = merge;
+	h->budget = budget;
+	h->depth = depth;
+	h->base = base;
+	h->spilling = 0;
+	h->slots = NULL;
+	h->used = NULL;
+	h->ent = NULL;
+	for (i = 0; i < HASHAGG_FANOUT; ++i) {
+		h->fds[i] = -1;
+		h->rows[i] = 0;
+	}
+	memset(&h->stats, 0, sizeof(h->stats));
+	h->stats.depth = depth;
+	/* Room for the largest table and, while growing, the one before. */
+	for (h->limit = 64; h->limit * 3 * (entSize + 1) <= avail;
+	    h->limit *= 2);
+	if (h->limit * 3 / 2 * (entSize + 1) > avail) {
+		printf("A budget of %zu bytes is too small to aggregate in.\n",
+		    budget);
+		return 1;
+	}
+	h->cap = h->limit < 1024 ? h->limit : 1024;
+	h->count = 0;
+	h->max = h->cap / 4 * 3;
+	h->slots = mem_huge_alloc(h->cap * entSize, MEM_QUERY);
+	h->used = mem_huge_alloc(h->cap, MEM_QUERY);
+	h->ent = malloc(entSize);
+	if (h->slots == NULL || h->used == NULL || h->ent == NULL) {
+		hashagg_free(h);
+		return 1;
+	}
+	memset(h->used, 0, h->cap);
+	note_peak(h, 0);
+	return 0;
+}
+
+/* Doubles the table. Returns 0 on success. */
+static int
+grow(struct hashagg *h)
+{
+	const size_t cap = h->cap * 2, mask = cap - 1;
+	char *slots = mem_huge_alloc(cap * h->entSize, MEM_QUERY);
+	uint8_t *used = mem_huge_alloc(cap, MEM_QUERY);
+	size_t i, j;
+	if (slots == NULL || used == NULL) {
+		mem_huge_free(slots, cap * h->entSize, MEM_QUERY);
+		mem_huge_free(used, cap, MEM_QUERY);
+		return 1;
+	}
+	memset(used, 0, cap);
+	for (i = 0; i < h->cap; ++i) {
+		const char *e = h->slots + i * h->entSize;
+		if (!h->used[i]) {
+			continue;
+		}
+		for (j = hash(*(const uint64_t *)e, h->depth) & mask; used[j];
+		    j = (j + 1) & mask);
+		memcpy(slots + j * h->entSize, e, h->entSize);
+		used[j] = 1;
+	}
+	mem_huge_free(h->slots, h->cap * h->entSize, MEM_QUERY);
+	mem_huge_free(h->used, h->cap, MEM_QUERY);
+	h->slots = slots;
+	h->used = used;
+	h->cap = cap;
+	h->max = cap / 4 * 3;
+	note_peak(h, cap / 2 * (h->entSize + 1));
+	return 0;
+}
+
+int
+hashagg_init(struct hashagg *h, unsigned int valSize, hashagg_merge merge,
+    size_t budget)
+{
+	{ /* Preconditions */
+		assert(h != NULL);
+		assert(valSize > 0);
+		assert(merge != NULL);
+	}
+	return init_level(h, valSize, merge, budget, 0, 0);
+}
+
+static int
+spill_start(struct hashagg *h)
+{
+	const char *dir = getenv("EVE_SPILLDIR");
+	char path[512];
+	unsigned int i;
+	if (h->depth >= HASHAGG_MAXDEPTH) {
+		printf("Too many groups for a budget of %zu bytes.\n",
+		    h->budget);
+		return 1;
+	}
+	if (arena_init(&h->arena, spill_bytes(h->entSize), MEM_QUEUE)) {
+		return 1;
+	}
+	for (i = 0; i < HASHAGG_FANOUT; ++i) {
+		snprintf(path, sizeof(path), "%s/eve-spill-XXXXXX",
+		    dir ? dir : "/tmp");
+		if ((h->fds[i] = mkstemp(path)) == -1) {
+			printf("Failed to make a spill file in %s\n",
+			    dir ? dir : "/tmp");
+			arena_free(&h->arena);
+			return 1;
+		}
+		unlink(path);
+		if (queue_init_arena(&h->q[i], h->fds[i], h->entSize,
+		    queue_block_count(h->entSize), &h->arena)) {
+			arena_free(&h->arena);
+			return 1;
+		}
+	}
+	h->spilling = 1;
+	h->stats.files += HASHAGG_FANOUT;
+	note_peak(h, 0);
+	return 0;
+}
+
+int
+hashagg_add(struct hashagg *h, uint64_t key, const void *val)
+{
+	const uint64_t x = hash(key, h->depth);
+	size_t i, mask = h->cap - 1;
+	unsigned int part;
+	char *e;
+	for (i = x & mask; h->used[i]; i = (i + 1) & mask) {
+		e = h->slots + i * h->entSize;
+		if (*(uint64_t *)e == key) {
+			h->merge(e + KEYSIZE, val);
+			return 0;
+		}
+	}
+	if (h->count == h->max && h->cap < h->limit && !h->spilling
+	    && grow(h) == 0) {
+		mask = h->cap - 1;
+		for (i = x & mask; h->used[i]; i = (i + 1) & mask);
+	}
+	if (h->count < h->max) {
+		e = h->slots + i * h->entSize;
+		*(uint64_t *)e = key;
+		memcpy(e + KEYSIZE, val, h->valSize);
+		h->used[i] = 1;
+		h->count++;
+		return 0;
+	}
+	/* Full: the row waits in its partition's spill file. */
+	if (!h->spilling && spill_start(h)) {
+		return 1;
+	}
+	part = (unsigned int)((x >> 56) % HASHAGG_FANOUT);
+	memcpy(h->ent, &key, KEYSIZE);
+	memcpy(h->ent + KEYSIZE, val, h->valSize);
+	h->rows[part]++;
+	h->stats.spilled++;
+	return queue_push(&h->q[part], h->ent);
+}
+
+/* Adds a block of spilled entries to the next level. */
+static int
+drain_block(const void *block, unsigned int n, void *arg)
+{
+	struct hashagg *child = arg;
+	const char *e = block;
+	for (; n > 0; --n, e += child->entSize) {
+		if (hashagg_add(child, *(const uint64_t *)e, e + KEYSIZE)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Aggregates spill file part of h a level down. */
+static int
+drain(struct hashagg *h, unsigned int part, hashagg_emit emit, void *arg)
+{
+	const int blockBytes = (int)(queue_block_count(h->entSize)
+	    * h->entSize);
+	const int fd = h->fds[part];
+	const int verify = checksum_on_read();
+	struct hashagg child;
+	struct queue_page pg;
+	char *page;
+	ssize_t rb;
+	int n, rc;
+	if ((page = mem_alloc(read_bytes(h->entSize), MEM_QUERY)) == NULL) {
+		return 1;
+	}
+	if (init_level(&child, h->valSize, h->merge, h->budget,
+	    h->depth + 1, h->base + read_bytes(h->entSize))) {
+		mem_free(page, read_bytes(h->entSize), MEM_QUERY);
+		return 1;
+	}
+	h->stats.pages += (uint64_t)lseek(fd, 0, SEEK_END) / PAGESIZE;
+	lseek(fd, 0, SEEK_SET);
+	while ((rb = read(fd, page, PAGESIZE)) == PAGESIZE) {
+		if (verify && queue_page_check(page)) {
+			printf("Spill page fails its checksum.\n");
+			goto fail;
+		}
+		queue_page_open(&pg, page, h->entSize);
+		if ((n = queue_page_each(&pg, page + PAGESIZE, blockBytes,
+		    drain_block, &child)) < 0) {
+			printf("Corrupt spill page.\n");
+			goto fail;
+		} else if (n > 0) {
+			goto fail;
+		}
+	}
+	if (rb != 0) {
+		printf("Short read from a spill file.\n");
+		goto fail;
+	}
+	rc = hashagg_finish(&child, emit, arg);
+	mem_free(page, read_bytes(h->entSize), MEM_QUERY);
+	h->stats.groups += child.stats.groups;
+	h->stats.spilled += child.stats.spilled;
+	h->stats.pages += child.stats.pages;
+	h->stats.files += child.stats.files;
+	if (child.stats.depth > h->stats.depth) {
+		h->stats.depth = child.stats.depth;
+	}
+	if (child.stats.peak > h->stats.peak) {
+		h->stats.peak = child.stats.peak;
+	}
+	return rc;
+
+fail:
+	hashagg_free(&child);
+	mem_free(page, read_bytes(h->entSize), MEM_QUERY);
+	return 1;
+}
+
+int
+hashagg_finish(struct hashagg *h, hashagg_emit emit, void *arg)
+{
+	unsigned int p;
+	size_t i;
+	int rc = 0;
+	{ /* Preconditions */
+		assert(h != NULL);
+		assert(emit != NULL);
+	}
+	for (i = 0; i < h->cap; ++i) {
+		if (h->used[i]) {
+			const char *e = h->slots + i * h->entSize;
+			emit(*(const uint64_t *)e, e + KEYSIZE, arg);
+			h->stats.groups++;
+		}
+	}
+	/* The table's memory goes to the next level. */
+	mem_huge_free(h->slots, h->cap * h->entSize, MEM_QUERY);
+	mem_huge_free(h->used, h->cap, MEM_QUERY);
+	h->slots = NULL;
+	h->used = NULL;
+	if (h->spilling) {
+		for (p = 0; p < HASHAGG_FANOUT; ++p) {
+			rc |= queue_commit(&h->q[p]);
+		}
+		arena_free(&h->arena);
+		h->spilling = 0;
+		for (p = 0; p < HASHAGG_FANOUT && rc == 0; ++p) {
+			if (h->rows[p] > 0) {
+				rc = drain(h, p, emit, arg);
+			}
+			close(h->fds[p]); /* Gives the disk space back. */
+			h->fds[p] = -1;
+		}
+	}
+	hashagg_free(h);
+	return rc;
+}
+
+void
+hashagg_free(struct hashagg *h)
+{
+	unsigned int p;
+	if (h->slots != NULL) {
+		mem_huge_free(h->slots, h->cap * h->entSize, MEM_QUERY);
+		mem_huge_free(h->used, h->cap, MEM_QUERY);
+		h->slots = NULL;
+		h->used = NULL;
+	}
+	if (h->spilling) {
+		arena_free(&h->arena);
+		h->spilling = 0;
+	}
+	for (p = 0; p < HASHAGG_FANOUT; ++p) {
+		if (h->fds[p] != -1) {
+			close(h->fds[p]);
+			h->fds[p] = -1;
+		}
+	}
+	free(h->ent);
+	h->ent = NULL;
+	return;
+}
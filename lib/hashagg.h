@@ -0,0 +1,88 @@
+#ifndef HASHAGG_H_
+#define HASHAGG_H_
+
+#include <stddef.h>	/* size_t */
+#include <stdint.h>	/* uint*_t */
+
+#include "arena.h"	/* struct arena */
+#include "queue.h"	/* struct queue */
+
+/*
+ * Hash aggregation (group by a 64 bit key) within a memory budget.
+ *
+ * Groups live in an open addressing table that doubles as needed, up to
+ * what the budget allows. Once that is full, rows for keys not already in
+ * it are hashed into HASHAGG_FANOUT spill files instead, lz4 compressed in
+ * queue pages (see queue.h); keys in the table keep aggregating in memory.
+ * hashagg_finish() emits the table, then aggregates each spill file the
+ * same way with a fresh hash seed, a block at a time while it's in L1,
+ * spilling again if a partition still doesn't fit. Big inputs get slower
+ * instead of running out of memory.
+ *
+ * A value is a fixed size aggregate state; merge folds one state into
+ * another and must be associative, since a spilled row meets its group
+ * again only in a later pass. EVE_SPILLDIR picks the spill directory,
+ * /tmp by default. Spill files are unlinked as soon as they're made.
+*/
+
+#define HASHAGG_FANOUT 16
+#define HASHAGG_MAXDEPTH 8
+
+typedef void (*hashagg_merge)(void *dst, const void *src);
+typedef void (*hashagg_emit)(uint64_t key, const void *val, void *arg);
+
+struct hashagg_stats {
+	uint64_t groups;	/* Emitted. */
+	uint64_t spilled;	/* Rows written to spill files. */
+	uint64_t pages;		/* Spill pages written. */
+	unsigned int files;
+	unsigned int depth;	/* Deepest recursion. */
+	size_t peak;		/* Most memory held at once. */
+};
+
+struct hashagg {
+	unsigned int valSize;
+	unsigned int entSize;	/* Key then value, padded to 8 bytes. */
+	hashagg_merge merge;
+	size_t budget;
+	unsigned int depth;	/* Recursion level; seeds the hash. */
+	size_t base;		/* Memory held by our callers' passes. */
+	char *slots;
+	uint8_t *used;
+	size_t cap;		/* Slots, a power of two. */
+	size_t limit;		/* Most slots the budget allows. */
+	size_t count;
+	size_t max;		/* Groups the table takes before spilling. */
+	char *ent;		/* Staging for one spilled entry. */
+	int spilling;
+	int fds[HASHAGG_FANOUT];
+	uint64_t rows[HASHAGG_FANOUT];	/* Spilled per file. */
+	struct queue q[HASHAGG_FANOUT];
+	struct arena arena;	/* Spill queue buffers. */
+	struct hashagg_stats stats;
+};
+
+/*
+ * budget is in bytes, for everything the aggregation allocates. Returns 0
+ * on success, 1 if it's too small to work in or allocation fails.
+*/
+int
+hashagg_init(struct hashagg *h, unsigned int valSize, hashagg_merge merge,
+    size_t budget);
+
+/* Folds val into key's group. Returns 0 on success. */
+int
+hashagg_add(struct hashagg *h, uint64_t key, const void *val);
+
+/*
+ * Calls emit once per group, in no particular order, then frees h.
+ * Returns 0 on success.
+*/
+int
+hashagg_finish(struct hashagg *h, hashagg_emit emit, void *arg);
+
+/* Frees h without emitting, after an error. */
+void
+hashagg_free(struct hashagg *h);
+
+#endif
@@ -0,0 +1,67 @@
+#include "hll.h"
+
+#include <string.h>	/* memset() */
+#include <math.h>	/* log(), ldexp() */
+
+/* splitmix64 finalizer; IDs are far from uniformly distributed. */
+static uint64_t
+mix(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+void
+hll_init(struct hll *h)
+{
+	memset(h->reg, 0, sizeof(h->reg));
+	return;
+}
+
+void
+hll_add(struct hll *h, uint64_t value)
+{
+	const uint64_t x = mix(value);
+	const unsigned int idx = (unsigned int)(x >> (64 - HLL_BITS));
+	/* Rank of the first set bit in the rest; the sentinel caps it. */
+	const uint64_t rest = (x << HLL_BITS) | (1ULL << (HLL_BITS - 1));
+	const uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+	if (rank > h->reg[idx]) {
+		h->reg[idx] = rank;
+	}
+	return;
+}
+
+void
+hll_merge(struct hll *dst, const struct hll *src)
+{
+	unsigned int i;
+	for (i = 0; i < HLL_REGS; ++i) {
+		if (src->reg[i] > dst->reg[i]) {
+			dst->reg[i] = src->reg[i];
+		}
+	}
+	return;
+}
+
+double
+hll_count(const struct hll *h)
+{
+	const double m = HLL_REGS;
+	const double alpha = 0.7213 / (1.0 + 1.079 / m);
+	double sum = 0, est;
+	unsigned int i, zeros = 0;
+	for (i = 0; i < HLL_REGS; ++i) {
+		sum += ldexp(1.0, -h->reg[i]);
+		zeros += h->reg[i] == 0;
+	}
+	est = alpha * m * m / sum;
+	if (est <= 2.5 * m && zeros > 0) { /* Small range: linear counting. */
+		est = m * log(m / zeros);
+	}
+	return est;
+}
@@ -0,0 +1,32 @@
+#ifndef HLL_H_
+#define HLL_H_
+
+#include <stdint.h>	/* uint*_t */
+
+/*
+ * HyperLogLog distinct-count sketch, 2^HLL_BITS one-byte registers
+ * (about 3% standard error). Sketches of disjoint or overlapping inputs
+ * merge by taking the larger register, so partial results from shards
+ * and partitions combine exactly.
+*/
+
+#define HLL_BITS 10
+#define HLL_REGS (1 << HLL_BITS)
+
+struct hll {
+	uint8_t reg[HLL_REGS];
+};
+
+void
+hll_init(struct hll *h);
+
+void
+hll_add(struct hll *h, uint64_t value);
+
+void
+hll_merge(struct hll *dst, const struct hll *src);
+
+double
+hll_count(const struct hll *h);
+
+#endif
@@ -0,0 +1,311 @@
+#include "market.h"
+
+#include <stdio.h>	/* printf(), snprintf() */
+#include <stdlib.h>	/* qsort() */
+#include <string.h>	/* memcpy(), memset(), strcmp() */
+#include <assert.h>	/* assert() */
+
+#include "mem.h"
+#include "scan.h"
+#include "shard.h"
+
+#define COLS (COL_BIT(COL_ORDERID) | COL_BIT(COL_STATIONID)		\
+    | COL_BIT(COL_TYPEID) | COL_BIT(COL_BID) | COL_BIT(COL_PRICE)	\
+    | COL_BIT(COL_VOLMIN) | COL_BIT(COL_VOLREM))
+
+/* An order on its way into a book. */
+struct row {
+	uint32_t typeID;
+	uint32_t stationID;
+	uint32_t bid;
+	uint32_t pad;
+	struct market_order o;
+};
+
+/* Books in key order; bids best first, then asks best first. */
+static int
+row_cmp(const void *a, const void *b)
+{
+	const struct row *x = a, *y = b;
+	if (x->typeID != y->typeID) {
+		return x->typeID < y->typeID ? -1 : 1;
+	}
+	if (x->stationID != y->stationID) {
+		return x->stationID < y->stationID ? -1 : 1;
+	}
+	if (x->bid != y->bid) {
+		return x->bid > y->bid ? -1 : 1;
+	}
+	if (x->o.price != y->o.price) { /* Highest bid, lowest ask first. */
+		return (x->bid ? x->o.price > y->o.price
+		    : x->o.price < y->o.price) ? -1 : 1;
+	}
+	if (x->o.orderID != y->o.orderID) {
+		return x->o.orderID < y->o.orderID ? -1 : 1;
+	}
+	return 0;
+}
+
+/*
+ * Appends p's orders to rows and, unless ids is NULL, their shards of
+ * nshards to ids. Returns 0 on success.
+*/
+static int
+add_partition(struct row *rows, uint8_t *ids, unsigned int nshards,
+    uint64_t *n, const struct partition *p, struct arena *a)
+{
+	struct scan scan;
+	struct scan_batch b;
+	size_t i;
+	int rc;
+	arena_reset(a);
+	if (scan_open(&scan, p, COLS, NULL, 0, a)) {
+		return 1;
+	}
+	while ((rc = scan_next(&scan, &b)) == 0) {
+		const uint64_t *orderID = b.col[COL_ORDERID];
+		const uint64_t *price = b.col[COL_PRICE];
+		const uint32_t *stationID = b.col[COL_STATIONID];
+		const uint32_t *typeID = b.col[COL_TYPEID];
+		const uint32_t *volMin = b.col[COL_VOLMIN];
+		const uint32_t *volRem = b.col[COL_VOLREM];
+		const uint8_t *bid = b.col[COL_BID];
+		if (ids != NULL) {
+			shard_ids(typeID, b.n, nshards, ids + *n);
+		}
+		for (i = 0; i < b.n; ++i) {
+			struct row *r = &rows[(*n)++];
+			r->typeID = typeID[i];
+			r->stationID = stationID[i];
+			r->bid = bid[i];
+			r->pad = 0;
+			r->o.price = price[i];
+			r->o.orderID = orderID[i];
+			r->o.volRem = volRem[i];
+			r->o.volMin = volMin[i];
+		}
+	}
+	scan_close(&scan);
+	return rc < 0;
+}
+
+/* One shard's orders, which no other shard has the typeIDs of. */
+struct run {
+	struct row *rows;
+	size_t n;
+};
+
+static void
+sort_run(void *arg)
+{
+	struct run *r = arg;
+	qsort(r->rows, r->n, sizeof(*r->rows), row_cmp);
+}
+
+/*
+ * Merges the sorted runs into rows in key order. A typeID is all in one
+ * run, so each step copies every order of the lowest typeID left.
+*/
+static void
+merge_runs(struct row *rows, struct run *runs, unsigned int nruns)
+{
+	struct run *min;
+	unsigned int s;
+	size_t k;
+	for (;;) {
+		for (s = 0, min = NULL; s < nruns; ++s) {
+			if (runs[s].n > 0 && (min == NULL
+			    || runs[s].rows->typeID < min->rows->typeID)) {
+				min = &runs[s];
+			}
+		}
+		if (min == NULL) {
+			return;
+		}
+		for (k = 1; k < min->n
+		    && min->rows[k].typeID == min->rows->typeID; ++k) {
+			continue;
+		}
+		memcpy(rows, min->rows, sizeof(*rows) * k);
+		rows += k;
+		min->rows += k;
+		min->n -= k;
+	}
+}
+
+/*
+ * Sorts the n rows, of shards ids, as qsort() would: scatters them into a
+ * run per shard, sorts the runs on pool workers, and merges them back.
+ * Returns 0 on success.
+*/
+static int
+sort_sharded(struct row *rows, uint64_t n, const uint8_t *ids,
+    unsigned int nshards, struct pool *pool)
+{
+	struct run runs[SHARD_MAX];
+	struct pool_group group = { 0 };
+	size_t offsets[SHARD_MAX + 1], at[SHARD_MAX];
+	struct row *tmp;
+	unsigned int s;
+	uint64_t i;
+	if ((tmp = mem_alloc(sizeof(*tmp) * (n + 1), MEM_MARKET)) == NULL) {
+		return 1;
+	}
+	shard_offsets(ids, n, nshards, offsets);
+	memcpy(at, offsets, sizeof(*at) * nshards);
+	for (i = 0; i < n; ++i) {
+		tmp[at[ids[i]]++] = rows[i];
+	}
+	for (s = 0; s < nshards; ++s) {
+		runs[s].rows = tmp + offsets[s];
+		runs[s].n = offsets[s + 1] - offsets[s];
+		if (pool_submit(pool, POOL_LOW, sort_run, &runs[s], &group)) {
+			sort_run(&runs[s]);
+		}
+	}
+	pool_wait(pool, &group);
+	merge_runs(rows, runs, nshards);
+	mem_free(tmp, sizeof(*tmp) * (n + 1), MEM_MARKET);
+	return 0;
+}
+
+int
+market_build(struct market_book *b, const struct store *s, const char *date,
+    struct arena *a, struct pool *pool)
+{
+	const unsigned int nshards = (pool == NULL) ? 1
+	    : (pool->nworkers < SHARD_MAX) ? pool->nworkers : SHARD_MAX;
+	struct row *rows;
+	uint8_t *ids = NULL;
+	uint64_t total = 0, n = 0, i;
+	unsigned int part;
+	struct market_key *k;
+	int rc = 0;
+	{ /* Preconditions */
+		assert(b != NULL);
+		assert(s != NULL);
+		assert(date != NULL);
+	}
+	memset(b, 0, sizeof(*b));
+	snprintf(b->date, sizeof(b->date), "%s", date);
+	for (part = 0; part < s->nparts; ++part) {
+		if (strcmp(s->parts[part].date, date) == 0) {
+			total += s->parts[part].rows;
+		}
+	}
+	if (total >= UINT32_MAX) { /* market_key.first */
+		printf("Too many orders for a book: %llu\n",
+		    (unsigned long long)total);
+		return 1;
+	}
+	if ((rows = mem_alloc(sizeof(*rows) * (total + 1), MEM_MARKET))
+	    == NULL || (nshards > 1 && (ids = mem_alloc(total + 1,
+	    MEM_MARKET)) == NULL)) {
+		mem_free(rows, sizeof(*rows) * (total + 1), MEM_MARKET);
+		return 1;
+	}
+	for (part = 0; part < s->nparts && !rc; ++part) {
+		rc = strcmp(s->parts[part].date, date) == 0
+		    && add_partition(rows, ids, nshards, &n, &s->parts[part],
+		    a);
+	}
+	if (!rc) {
+		assert(n == total);
+		if (nshards > 1) {
+			rc = sort_sharded(rows, n, ids, nshards, pool);
+		} else {
+			qsort(rows, n, sizeof(*rows), row_cmp);
+		}
+	}
+	mem_free(ids, total + 1, MEM_MARKET);
+	if (rc) {
+		mem_free(rows, sizeof(*rows) * (total + 1), MEM_MARKET);
+		return 1;
+	}
+	for (i = 0; i < n; ++i) {
+		b->nkeys += i == 0 || rows[i].typeID != rows[i - 1].typeID
+		    || rows[i].stationID != rows[i - 1].stationID;
+	}
+	b->norders = n;
+	b->keys = mem_alloc(sizeof(*b->keys) * (b->nkeys + 1), MEM_MARKET);
+	b->orders = mem_alloc(sizeof(*b->orders) * (n + 1), MEM_MARKET);
+	if (b->keys == NULL || b->orders == NULL) {
+		mem_free(rows, sizeof(*rows) * (total + 1), MEM_MARKET);
+		market_free(b);
+		return 1;
+	}
+	for (i = 0, k = NULL; i < n; ++i) {
+		if (k == NULL || rows[i].typeID != k->typeID
+		    || rows[i].stationID != k->stationID) {
+			k = (k == NULL) ? b->keys : k + 1;
+			k->typeID = rows[i].typeID;
+			k->stationID = rows[i].stationID;
+			k->first = (uint32_t)i;
+			k->nbids = k->nasks = 0;
+		}
+		if (rows[i].bid) {
+			k->nbids++;
+		} else {
+			k->nasks++;
+		}
+		b->orders[i] = rows[i].o;
+	}
+	mem_free(rows, sizeof(*rows) * (total + 1), MEM_MARKET);
+	return 0;
+}
+
+void
+market_free(struct market_book *b)
+{
+	mem_free(b->keys, sizeof(*b->keys) * (b->nkeys + 1), MEM_MARKET);
+	mem_free(b->orders, sizeof(*b->orders) * (b->norders + 1),
+	    MEM_MARKET);
+	b->keys = NULL;
+	b->orders = NULL;
+	b->nkeys = 0;
+	b->norders = 0;
+	return;
+}
+
+const struct market_key *
+market_find(const struct market_book *b, uint32_t typeID, uint32_t stationID)
+{
+	uint32_t lo = 0, hi = b->nkeys;
+	const uint64_t want = (uint64_t)typeID << 32 | stationID;
+	while (lo < hi) {
+		const uint32_t mid = lo + (hi - lo) / 2;
+		const struct market_key *k = &b->keys[mid];
+		const uint64_t key = (uint64_t)k->typeID << 32 | k->stationID;
+		if (key == want) {
+			return k;
+		} else if (key < want) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return NULL;
+}
+
+void
+market_answer(const struct market_book *b, const struct market_query *q,
+    struct market_reply *r)
+{
+	const struct market_key *k;
+	const uint32_t depth = q->depth < MARKET_DEPTH ? q->depth
+	    : MARKET_DEPTH;
+	memset(r, 0, sizeof(*r));
+	if (b == NULL) {
+		r->rc = 1;
+		return;
+	}
+	snprintf(r->date, sizeof(r->date), "%s", b->date);
+	if ((k = market_find(b, q->typeID, q->stationID)) == NULL) {
+		return;
+	}
+	r->nbids = k->nbids < depth ? k->nbids : depth;
+	r->nasks = k->nasks < depth ? k->nasks : depth;
+	memcpy(r->bids, &b->orders[k->first], sizeof(*r->bids) * r->nbids);
+	memcpy(r->asks, &b->orders[k->first + k->nbids],
+	    sizeof(*r->asks) * r->nasks);
+}
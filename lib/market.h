@@ -0,0 +1,83 @@
+#ifndef MARKET_H_
+#define MARKET_H_
+
+#include <stdint.h>	/* uint*_t */
+
+#include "arena.h"	/* struct arena */
+#include "pool.h"	/* struct pool */
+#include "store.h"	/* struct store */
+
+/*
+ * The current market: every order of one dump, the newest segment of a
+ * store, kept in memory and indexed by (typeID, stationID). Each book
+ * holds its bids best (highest) first, then its asks best (lowest)
+ * first. A built book is never changed; marketd.c builds a new one per
+ * ingest and swaps it in with rcu.h, so readers never wait for it.
+*/
+
+#define MARKET_DEPTH 16
+
+struct market_order {
+	uint64_t price;
+	uint64_t orderID;
+	uint32_t volRem;
+	uint32_t volMin;
+};
+
+struct market_key {
+	uint32_t typeID;
+	uint32_t stationID;
+	uint32_t first;		/* Its first order. */
+	uint32_t nbids;
+	uint32_t nasks;		/* After the bids. */
+};
+
+struct market_book {
+	char date[11];			/* Of the segment. */
+	uint32_t nkeys;
+	uint64_t norders;
+	struct market_key *keys;	/* By typeID, then stationID. */
+	struct market_order *orders;
+};
+
+/* A reader's request, and what marketd sends back for each. */
+struct market_query {
+	uint32_t typeID;
+	uint32_t stationID;
+	uint32_t depth;		/* Orders per side, <= MARKET_DEPTH. */
+	uint32_t pad;
+};
+
+struct market_reply {
+	int32_t rc;		/* 0, or there's no book yet. */
+	uint32_t nbids;
+	uint32_t nasks;
+	uint32_t pad;
+	char date[16];
+	struct market_order bids[MARKET_DEPTH];
+	struct market_order asks[MARKET_DEPTH];
+};
+
+/*
+ * Builds b from the partitions of s dated date. Scan buffers come from a,
+ * which is reset. Unless pool is NULL, the orders are sharded by typeID
+ * over its workers (see shard.h), each sorting its own books. Returns 0
+ * on success.
+*/
+int
+market_build(struct market_book *b, const struct store *s, const char *date,
+    struct arena *a, struct pool *pool);
+
+void
+market_free(struct market_book *b);
+
+/* Returns the book of (typeID, stationID), or NULL if it has no orders. */
+const struct market_key *
+market_find(const struct market_book *b, uint32_t typeID, uint32_t stationID);
+
+/* Answers q from b, NULL while there's none. */
+void
+market_answer(const struct market_book *b, const struct market_query *q,
+    struct market_reply *r);
+
+#endif
@@ -0,0 +1,252 @@
+#define _GNU_SOURCE	/* MAP_HUGETLB, MADV_HUGEPAGE */
+#include "mem.h"
+
+#include <stdio.h>	/* printf(), fopen() */
+#include <stdlib.h>	/* malloc(), getenv() */
+#include <string.h>	/* strcmp() */
+#include <pthread.h>	/* pthread_mutex_lock() */
+#include <sys/mman.h>	/* mmap(), madvise() */
+
+enum { MODE_UNSET, MODE_OFF, MODE_THP, MODE_HUGETLB };
+
+static int mode = MODE_UNSET;
+static struct mem_stats stats;
+static struct mem_usage usage[MEM_NTAGS];
+
+/*
+ * Which counter each large mapping was charged to, so freeing it uncharges
+ * the right one. A stage only holds a handful of large buffers.
+*/
+#define MAXMAPS 64
+static struct { void *p; size_t *counter; } maps[MAXMAPS];
+
+/*
+ * Guards mode, maps and stats, for threads mapping buffers at once. Large
+ * buffers are few and long-lived, so it's never contended.
+*/
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Called with lock held. */
+static int
+get_mode(void)
+{
+	const char *env;
+	if (mode != MODE_UNSET) {
+		return mode;
+	}
+	env = getenv("EVE_HUGEPAGES");
+	if (env == NULL || strcmp(env, "thp") == 0) {
+		mode = MODE_THP;
+	} else if (strcmp(env, "off") == 0) {
+		mode = MODE_OFF;
+	} else if (strcmp(env, "hugetlb") == 0) {
+		mode = MODE_HUGETLB;
+	} else {
+		printf("Unknown EVE_HUGEPAGES=%s, using thp\n", env);
+		mode = MODE_THP;
+	}
+	return mode;
+}
+
+static size_t
+round_huge(size_t size)
+{
+	return (size + HUGEPAGE_SIZE - 1) & ~(HUGEPAGE_SIZE - 1);
+}
+
+static void
+remember(void *p, size_t *counter, size_t size)
+{
+	int i;
+	pthread_mutex_lock(&lock);
+	for (i = 0; i < MAXMAPS; ++i) {
+		if (maps[i].p == NULL) {
+			maps[i].p = p;
+			maps[i].counter = counter;
+			break;
+		}
+	}
+	/* A full table only costs us the per-kind accounting. */
+	*counter += (i < MAXMAPS) ? size : 0;
+	pthread_mutex_unlock(&lock);
+}
+
+/* Charges delta bytes to tag; allocations count when delta > 0. */
+static void
+charge(enum mem_tag tag, size_t old, size_t size)
+{
+	struct mem_usage *u = &usage[tag];
+	size_t cur, peak;
+	if (size > old) {
+		cur = __atomic_add_fetch(&u->cur, size - old,
+		    __ATOMIC_RELAXED);
+		__atomic_add_fetch(&u->allocs, 1, __ATOMIC_RELAXED);
+		peak = __atomic_load_n(&u->peak, __ATOMIC_RELAXED);
+		while (cur > peak && !__atomic_compare_exchange_n(&u->peak,
+		    &peak, cur, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	} else {
+		__atomic_sub_fetch(&u->cur, old - size, __ATOMIC_RELAXED);
+	}
+}
+
+static void *
+huge_alloc(size_t size)
+{
+	void *p;
+	const size_t len = round_huge(size);
+	int m;
+
+	if (size < HUGEPAGE_SIZE) {
+		return malloc(size);
+	}
+	pthread_mutex_lock(&lock);
+	m = get_mode();
+	pthread_mutex_unlock(&lock);
+	if (m == MODE_HUGETLB) {
+		p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED) {
+			remember(p, &stats.hugetlb, len);
+			return p;
+		}
+	}
+	/* THP, and the fallback for an empty hugetlb pool. */
+	p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) {
+		return NULL;
+	}
+	if (m != MODE_OFF && madvise(p, len, MADV_HUGEPAGE) == 0) {
+		remember(p, &stats.thp, len);
+	} else {
+		remember(p, &stats.plain, len);
+	}
+	return p;
+}
+
+void *
+mem_huge_alloc(size_t size, enum mem_tag tag)
+{
+	void *p = huge_alloc(size);
+	if (p != NULL) {
+		charge(tag, 0, size);
+	}
+	return p;
+}
+
+void
+mem_huge_free(void *p, size_t size, enum mem_tag tag)
+{
+	int i;
+	const size_t len = round_huge(size);
+	if (p == NULL) {
+		return;
+	}
+	charge(tag, size, 0);
+	if (size < HUGEPAGE_SIZE) {
+		free(p);
+		return;
+	}
+	pthread_mutex_lock(&lock);
+	for (i = 0; i < MAXMAPS; ++i) {
+		if (maps[i].p == p) {
+			*maps[i].counter -= len;
+			maps[i].p = NULL;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&lock);
+	munmap(p, len);
+}
+
+void
+mem_huge_stats(struct mem_stats *s)
+{
+	pthread_mutex_lock(&lock);
+	*s = stats;
+	pthread_mutex_unlock(&lock);
+}
+
+void
+mem_huge_report(const char *stage)
+{
+	char buf[256];
+	unsigned long anon_huge = 0;
+	struct mem_stats st;
+	FILE *f;
+	/* THP is best effort, so ask the kernel what it actually did. */
+	if ((f = fopen("/proc/self/smaps_rollup", "r"))) {
+		while (fgets(buf, sizeof(buf), f)) {
+			if (sscanf(buf, "AnonHugePages: %lu kB", &anon_huge)) {
+				break;
+			}
+		}
+		fclose(f);
+	}
+	mem_huge_stats(&st);
+	printf("%s: hugetlb %zu kB thp-advised %zu kB thp-backed %lu kB"
+	    " plain %zu kB\n", stage, st.hugetlb >> 10, st.thp >> 10,
+	    anon_huge, st.plain >> 10);
+}
+
+void *
+mem_alloc(size_t size, enum mem_tag tag)
+{
+	void *p = malloc(size);
+	if (p != NULL) {
+		charge(tag, 0, size);
+	}
+	return p;
+}
+
+void *
+mem_realloc(void *p, size_t old, size_t size, enum mem_tag tag)
+{
+	void *q = realloc(p, size);
+	if (q != NULL) {
+		charge(tag, p != NULL ? old : 0, size);
+	}
+	return q;
+}
+
+void
+mem_free(void *p, size_t size, enum mem_tag tag)
+{
+	if (p != NULL) {
+		charge(tag, size, 0);
+		free(p);
+	}
+}
+
+void
+mem_usage(enum mem_tag tag, struct mem_usage *u)
+{
+	u->cur = __atomic_load_n(&usage[tag].cur, __ATOMIC_RELAXED);
+	u->peak = __atomic_load_n(&usage[tag].peak, __ATOMIC_RELAXED);
+	u->allocs = __atomic_load_n(&usage[tag].allocs, __ATOMIC_RELAXED);
+}
+
+const char *
+mem_tag_name(enum mem_tag tag)
+{
+	static const char *const names[MEM_NTAGS] = {
+		"other", "parser", "queue", "scan", "index", "query", "market"
+	};
+	return names[tag];
+}
+
+void
+mem_tag_report(const char *stage)
+{
+	struct mem_usage u;
+	int tag;
+	for (tag = 0; tag < MEM_NTAGS; ++tag) {
+		mem_usage((enum mem_tag)tag, &u);
+		if (u.allocs == 0) {
+			continue;
+		}
+		printf("%s: mem %s %zu kB, peak %zu kB, %lu allocs\n", stage,
+		    mem_tag_name((enum mem_tag)tag), u.cur >> 10, u.peak >> 10,
+		    u.allocs);
+	}
+}
@@ -0,0 +1,85 @@
+#ifndef MEM_H_
+#define MEM_H_
+
+#include <stddef.h>	/* size_t */
+
+/*
+ * Allocator for large, long-lived buffers that are streamed through
+ * sequentially (queue staging arrays, parser input buffers). Those are
+ * backed by 2 MiB pages to cut TLB misses.
+ *
+ * EVE_HUGEPAGES selects how:
+ *	off	plain pages.
+ *	thp	mmap() + madvise(MADV_HUGEPAGE), the default.
+ *	hugetlb	mmap(MAP_HUGETLB) from the reserved pool, falling back to
+ *		thp when the pool is empty.
+ * Requests smaller than HUGEPAGE_SIZE always come from malloc().
+ *
+ * Every allocation here is charged to a subsystem tag, so a report can
+ * say where the memory went. Charging is a couple of relaxed atomic adds
+ * per allocation; nothing is done per row. mem_alloc() and friends do the
+ * same for heap blocks that are worth counting.
+*/
+
+#define HUGEPAGE_SIZE (2UL << 20)
+
+enum mem_tag {
+	MEM_OTHER = 0,
+	MEM_PARSER,	/* Input buffers, inflate buffers. */
+	MEM_QUEUE,	/* Queue staging and pages, spill buffers. */
+	MEM_SCAN,	/* Column scan buffers. */
+	MEM_INDEX,	/* Dictionaries, stats, gzip and zstd indexes. */
+	MEM_QUERY,	/* Query scratch, hash tables. */
+	MEM_MARKET,	/* Resident current-market books. */
+	MEM_NTAGS
+};
+
+struct mem_usage {
+	size_t cur;		/* Bytes held now. */
+	size_t peak;		/* Most bytes held at once. */
+	unsigned long allocs;
+};
+
+struct mem_stats {
+	size_t hugetlb;	/* Bytes currently mapped with MAP_HUGETLB. */
+	size_t thp;	/* Bytes currently madvise()d for THP. */
+	size_t plain;	/* Bytes currently in large regular mappings. */
+};
+
+/* Returns NULL on failure. */
+void *
+mem_huge_alloc(size_t size, enum mem_tag tag);
+
+/* size and tag must be those given to mem_huge_alloc(). */
+void
+mem_huge_free(void *p, size_t size, enum mem_tag tag);
+
+void
+mem_huge_stats(struct mem_stats *s);
+
+/* Prints the counters and how much THP the kernel actually gave us. */
+void
+mem_huge_report(const char *stage);
+
+/* Counted malloc(), realloc() and free(); sizes as for mem_huge_free(). */
+void *
+mem_alloc(size_t size, enum mem_tag tag);
+
+void *
+mem_realloc(void *p, size_t old, size_t size, enum mem_tag tag);
+
+void
+mem_free(void *p, size_t size, enum mem_tag tag);
+
+/* Snapshot of one tag's counters. */
+void
+mem_usage(enum mem_tag tag, struct mem_usage *u);
+
+const char *
+mem_tag_name(enum mem_tag tag);
+
+/* Prints current, peak and allocation count of every tag in use. */
+void
+mem_tag_report(const char *stage);
+
+#endif
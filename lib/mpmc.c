@@ -0,0 +1,222 @@
+#include "mpmc.h"
+
+#include <stdlib.h>	/* malloc() */
+#include <stdint.h>	/* intptr_t */
+#include <limits.h>	/* INT_MAX */
+#include <unistd.h>	/* syscall(), sysconf() */
+#include <sys/syscall.h>	/* SYS_futex */
+#include <linux/futex.h>	/* FUTEX_WAIT */
+#include <assert.h>	/* assert() */
+
+#define SPINS 256
+
+static void
+cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+static void
+futex_wait(int *addr, int val)
+{
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static void
+futex_wake(int *addr, int count)
+{
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+int
+mpmc_init(struct mpmc *q, size_t cap)
+{
+	size_t i, size = 2;
+	{ /* Preconditions */
+		assert(q != NULL);
+		assert(cap > 0);
+	}
+	while (size < cap) {
+		size *= 2;
+	}
+	if ((q->cells = malloc(sizeof(*q->cells) * size)) == NULL) {
+		return 1;
+	}
+	for (i = 0; i < size; ++i) {
+		q->cells[i].seq = i;
+	}
+	q->mask = size - 1;
+	q->head = q->tail = 0;
+	q->pushes = q->pops = q->popwaiters = q->pushwaiters = 0;
+	q->closed = 0;
+	/* Spinning only pays if the other side runs at the same time. */
+	q->spins = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? SPINS : 0;
+	return 0;
+}
+
+void
+mpmc_free(struct mpmc *q)
+{
+	free(q->cells);
+	q->cells = NULL;
+	return;
+}
+
+static int
+push_cell(struct mpmc *q, void *data)
+{
+	struct mpmc_cell *cell;
+	size_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	for (;;) {
+		intptr_t dif;
+		cell = &q->cells[pos & q->mask];
+		dif = (intptr_t)__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE)
+		    - (intptr_t)pos;
+		if (dif == 0) { /* Cell is free for this lap, claim it. */
+			if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1,
+			    1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (dif < 0) { /* Still holds last lap's value. */
+			return 1;
+		} else { /* Someone else claimed it first. */
+			pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+		}
+	}
+	cell->data = data;
+	__atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static int
+pop_cell(struct mpmc *q, void **data)
+{
+	struct mpmc_cell *cell;
+	size_t pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+	for (;;) {
+		intptr_t dif;
+		cell = &q->cells[pos & q->mask];
+		dif = (intptr_t)__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE)
+		    - (intptr_t)(pos + 1);
+		if (dif == 0) {
+			if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1,
+			    1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (dif < 0) { /* Nothing pushed here yet. */
+			return 1;
+		} else {
+			pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+		}
+	}
+	*data = cell->data;
+	__atomic_store_n(&cell->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/*
+ * Tells sleepers on *word that a cell changed hands. Clearing the flag
+ * means only the first handoff after someone went to sleep pays for the
+ * syscall; the woken threads set it again if they have to sleep again.
+*/
+static void
+bump(int *word, int *waiters)
+{
+	__atomic_add_fetch(word, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(waiters, __ATOMIC_SEQ_CST)
+	    && __atomic_exchange_n(waiters, 0, __ATOMIC_SEQ_CST)) {
+		futex_wake(word, INT_MAX);
+	}
+}
+
+int
+mpmc_try_push(struct mpmc *q, void *data)
+{
+	if (push_cell(q, data)) {
+		return 1;
+	}
+	bump(&q->pushes, &q->popwaiters);
+	return 0;
+}
+
+int
+mpmc_try_pop(struct mpmc *q, void **data)
+{
+	if (pop_cell(q, data)) {
+		return 1;
+	}
+	bump(&q->pops, &q->pushwaiters);
+	return 0;
+}
+
+/*
+ * Tries op, spins, then sleeps on *word until op succeeds. The word is
+ * read before the last attempt, so a bump in between makes the futex
+ * return at once. Once the queue is closed, gives up; pops first take
+ * what's left.
+*/
+static int
+wait_for(struct mpmc *q, int *word, int *waiters,
+    int (*op)(struct mpmc *, void **), void **data, int drain)
+{
+	int i, seen;
+	/* Try once even without spins, or each pop would mark a waiter. */
+	for (i = 0; i <= q->spins; ++i) {
+		if (op(q, data) == 0) {
+			return 0;
+		}
+		cpu_relax();
+	}
+	for (;;) {
+		seen = __atomic_load_n(word, __ATOMIC_SEQ_CST);
+		__atomic_store_n(waiters, 1, __ATOMIC_SEQ_CST);
+		if (op(q, data) == 0) {
+			return 0;
+		}
+		if (__atomic_load_n(&q->closed, __ATOMIC_SEQ_CST)) {
+			return drain ? op(q, data) : 1;
+		}
+		futex_wait(word, seen);
+	}
+}
+
+static int
+push_op(struct mpmc *q, void **data)
+{
+	return push_cell(q, *data);
+}
+
+int
+mpmc_push(struct mpmc *q, void *data)
+{
+	if (__atomic_load_n(&q->closed, __ATOMIC_SEQ_CST)) {
+		return 1;
+	}
+	if (wait_for(q, &q->pops, &q->pushwaiters, push_op, &data, 0)) {
+		return 1;
+	}
+	bump(&q->pushes, &q->popwaiters);
+	return 0;
+}
+
+int
+mpmc_pop(struct mpmc *q, void **data)
+{
+	if (wait_for(q, &q->pushes, &q->popwaiters, pop_cell, data, 1)) {
+		return 1;
+	}
+	bump(&q->pops, &q->pushwaiters);
+	return 0;
+}
+
+void
+mpmc_close(struct mpmc *q)
+{
+	__atomic_store_n(&q->closed, 1, __ATOMIC_SEQ_CST);
+	__atomic_add_fetch(&q->pushes, 1, __ATOMIC_SEQ_CST);
+	__atomic_add_fetch(&q->pops, 1, __ATOMIC_SEQ_CST);
+	futex_wake(&q->pushes, INT_MAX);
+	futex_wake(&q->pops, INT_MAX);
+}
@@ -0,0 +1,64 @@
+#ifndef MPMC_H_
+#define MPMC_H_
+
+#include <stddef.h>	/* size_t */
+
+/*
+ * Bounded lock-free multi-producer multi-consumer queue of pointers, after
+ * Dmitry Vyukov's design. Used to hand batches between pipeline stages,
+ * e.g. N parser threads feeding M compression workers.
+ *
+ * Every cell carries a sequence number that says whose turn it is, so a
+ * push or pop is one CAS on the shared position plus one store into the
+ * cell. The try_ variants never block. The blocking variants spin a
+ * little (handoffs are usually immediate) and then sleep on a futex.
+*/
+
+#define MPMC_LINE 64
+
+struct mpmc_cell {
+	size_t seq;
+	void *data;
+};
+
+struct mpmc {
+	struct mpmc_cell *cells;
+	size_t mask;
+	size_t head __attribute__((aligned(MPMC_LINE)));	/* Next push. */
+	size_t tail __attribute__((aligned(MPMC_LINE)));	/* Next pop. */
+	/* Futex words, bumped after every push/pop, and their sleepers. */
+	int pushes __attribute__((aligned(MPMC_LINE)));
+	int pops;
+	int popwaiters;		/* Someone may sleep on pushes. */
+	int pushwaiters;	/* Someone may sleep on pops. */
+	int closed;
+	int spins;	/* Tries before sleeping; none on a single CPU. */
+};
+
+/* cap is rounded up to a power of two. Returns 0 on success. */
+int
+mpmc_init(struct mpmc *q, size_t cap);
+
+void
+mpmc_free(struct mpmc *q);
+
+/* Return 0 on success, 1 if the queue is full (empty). */
+int
+mpmc_try_push(struct mpmc *q, void *data);
+
+int
+mpmc_try_pop(struct mpmc *q, void **data);
+
+/* Returns 0 on success, 1 if the queue was closed. */
+int
+mpmc_push(struct mpmc *q, void *data);
+
+/* Returns 0 on success, 1 once the queue is closed and drained. */
+int
+mpmc_pop(struct mpmc *q, void **data);
+
+/* No more pushes; wakes every sleeper. */
+void
+mpmc_close(struct mpmc *q);
+
+#endif
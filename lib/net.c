@@ -0,0 +1,165 @@
+#include "net.h"
+
+#include <stdio.h>	/* printf() */
+#include <stdlib.h>	/* atoi() */
+#include <string.h>	/* strncmp() */
+#include <unistd.h>	/* close() */
+#include <errno.h>	/* errno */
+#include <netdb.h>	/* getaddrinfo() */
+#include <sys/socket.h>	/* socket() */
+#include <sys/un.h>	/* struct sockaddr_un */
+
+/* Fills a unix socket address. Returns 1 if the path doesn't fit. */
+static int
+unix_addr(const char *path, struct sockaddr_un *sun)
+{
+	memset(sun, 0, sizeof(*sun));
+	sun->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(sun->sun_path)) {
+		printf("Socket path too long: %s\n", path);
+		return 1;
+	}
+	strcpy(sun->sun_path, path);
+	return 0;
+}
+
+/* Splits "host:port" or "port". host is "" when absent. */
+static void
+split_hostport(const char *spec, char *host, size_t hostlen, const char **port)
+{
+	const char *colon = strrchr(spec, ':');
+	size_t n = colon ? (size_t)(colon - spec) : 0;
+	if (n >= hostlen) {
+		n = hostlen - 1;
+	}
+	memcpy(host, spec, n);
+	host[n] = '\0';
+	*port = colon ? colon + 1 : spec;
+}
+
+static int
+tcp_socket(const char *spec, int listening)
+{
+	struct addrinfo hints, *res, *ai;
+	char host[256];
+	const char *port;
+	int fd = -1, one = 1, rc;
+	split_hostport(spec, host, sizeof(host), &port);
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = listening ? AI_PASSIVE : 0;
+	if ((rc = getaddrinfo(host[0] ? host : NULL, port, &hints, &res))) {
+		printf("Bad address tcp:%s: %s\n", spec, gai_strerror(rc));
+		return -1;
+	}
+	for (ai = res; ai != NULL; ai = ai->ai_next) {
+		if ((fd = socket(ai->ai_family, ai->ai_socktype,
+		    ai->ai_protocol)) == -1) {
+			continue;
+		}
+		if (listening) {
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one,
+			    sizeof(one));
+			if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0
+			    && listen(fd, 64) == 0) {
+				break;
+			}
+		} else if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+			break;
+		}
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(res);
+	if (fd == -1) {
+		printf("Failed to %s tcp:%s with error: %s\n",
+		    listening ? "listen on" : "connect to", spec,
+		    strerror(errno));
+	}
+	return fd;
+}
+
+int
+net_listen(const char *addr)
+{
+	struct sockaddr_un sun;
+	int fd;
+	if (strncmp(addr, "tcp:", 4) == 0) {
+		return tcp_socket(addr + 4, 1);
+	}
+	if (strncmp(addr, "unix:", 5) || unix_addr(addr + 5, &sun)) {
+		printf("Bad address %s\n", addr);
+		return -1;
+	}
+	unlink(sun.sun_path); /* A stale socket from a previous run. */
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1
+	    || bind(fd, (struct sockaddr *)&sun, sizeof(sun))
+	    || listen(fd, 64)) {
+		printf("Failed to listen on %s with error: %s\n",
+		    addr, strerror(errno));
+		if (fd != -1) {
+			close(fd);
+		}
+		return -1;
+	}
+	return fd;
+}
+
+int
+net_connect(const char *addr)
+{
+	struct sockaddr_un sun;
+	int fd;
+	if (strncmp(addr, "tcp:", 4) == 0) {
+		return tcp_socket(addr + 4, 0);
+	}
+	if (strncmp(addr, "unix:", 5) || unix_addr(addr + 5, &sun)) {
+		printf("Bad address %s\n", addr);
+		return -1;
+	}
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1
+	    || connect(fd, (struct sockaddr *)&sun, sizeof(sun))) {
+		printf("Failed to connect to %s with error: %s\n",
+		    addr, strerror(errno));
+		if (fd != -1) {
+			close(fd);
+		}
+		return -1;
+	}
+	return fd;
+}
+
+int
+net_write(int fd, const void *buf, size_t len)
+{
+	ssize_t wb;
+	while (len > 0) {
+		if ((wb = send(fd, buf, len, MSG_NOSIGNAL)) <= 0) {
+			if (wb == -1 && errno == EINTR) {
+				continue;
+			}
+			return 1;
+		}
+		buf = (const char *)buf + wb;
+		len -= (size_t)wb;
+	}
+	return 0;
+}
+
+int
+net_read(int fd, void *buf, size_t len)
+{
+	ssize_t rb;
+	while (len > 0) {
+		if ((rb = read(fd, buf, len)) <= 0) {
+			if (rb == -1 && errno == EINTR) {
+				continue;
+			}
+			return 1;
+		}
+		buf = (char *)buf + rb;
+		len -= (size_t)rb;
+	}
+	return 0;
+}
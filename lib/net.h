@@ -0,0 +1,26 @@
+#ifndef NET_H_
+#define NET_H_
+
+#include <stddef.h>	/* size_t */
+
+/*
+ * Stream sockets for shard servers and the coordinator. An address is
+ * "unix:/path/to/socket" or "tcp:host:port" ("tcp:port" to listen on every
+ * interface).
+*/
+
+/* Return a socket, or -1 after printing why. */
+int
+net_listen(const char *addr);
+
+int
+net_connect(const char *addr);
+
+/* Return 0 once all len bytes went through, 1 on errors or EOF. */
+int
+net_write(int fd, const void *buf, size_t len);
+
+int
+net_read(int fd, void *buf, size_t len);
+
+#endif
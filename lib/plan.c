@@ -0,0 +1,87 @@
+#include "plan.h"
+
+#include <string.h>	/* memset() */
+#include <assert.h>	/* assert() */
+
+#include "scan.h"
+#include "shard.h"
+
+/* Whether row group z may hold rows matching q. */
+static int
+zone_match(const struct zone *z, const struct query *q, uint64_t to)
+{
+	if (q->typeID && (q->typeID < z->min[STAT_TYPEID]
+	    || q->typeID > z->max[STAT_TYPEID])) {
+		return 0;
+	}
+	if (q->regionID && (q->regionID < z->min[STAT_REGIONID]
+	    || q->regionID > z->max[STAT_REGIONID])) {
+		return 0;
+	}
+	return q->from <= z->max[STAT_RTIME] && to > z->min[STAT_RTIME];
+}
+
+void
+plan_partition(struct plan *pl, const struct partition *p,
+    const struct stats *st, const struct query *q, uint8_t *keep)
+{
+	const uint64_t to = q->to ? q->to : UINT64_MAX;
+	double rows;
+	uint64_t g;
+	{ /* Preconditions */
+		assert(pl != NULL);
+		assert(p != NULL);
+		assert(q != NULL);
+		assert(keep != NULL);
+	}
+	pl->ngroups = scan_ngroups(p);
+	if (q->typeID && shard_of(q->typeID, p->nshards) != p->shard) {
+		pl->path = PLAN_PRUNE;
+		pl->kept = 0;
+		pl->est = 0;
+		return;
+	}
+	if (st == NULL) {
+		memset(keep, 1, pl->ngroups);
+		pl->path = PLAN_SCAN;
+		pl->kept = pl->ngroups;
+		pl->est = (double)p->rows;
+		return;
+	}
+	rows = (double)st->rows;
+	pl->est = rows;
+	if (rows > 0 && q->typeID) {
+		pl->est *= stats_eq(st, STAT_TYPEID, q->typeID) / rows;
+	}
+	if (rows > 0 && q->regionID) {
+		pl->est *= stats_eq(st, STAT_REGIONID, q->regionID) / rows;
+	}
+	if (rows > 0 && (q->from || q->to)) {
+		pl->est *= stats_range(st, STAT_RTIME, q->from, to) / rows;
+	}
+	if (q->bid >= 0) { /* No stats; buys and sells are about even. */
+		pl->est *= 0.5;
+	}
+	pl->kept = 0;
+	for (g = 0; g < pl->ngroups; ++g) {
+		keep[g] = (uint8_t)zone_match(&st->zones[g], q, to);
+		pl->kept += keep[g];
+	}
+	if (pl->kept == 0 || pl->est == 0) {
+		pl->path = PLAN_PRUNE;
+		pl->kept = 0;
+		pl->est = 0;
+	} else if (pl->kept * PLAN_SKIP_COST < pl->ngroups) {
+		pl->path = PLAN_SKIP;
+	} else {
+		pl->path = PLAN_SCAN;
+	}
+	return;
+}
+
+const char *
+plan_path_name(enum plan_path path)
+{
+	static const char *const names[] = { "prune", "scan", "skip" };
+	return names[path];
+}
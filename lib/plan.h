@@ -0,0 +1,47 @@
+#ifndef PLAN_H_
+#define PLAN_H_
+
+#include <stdint.h>	/* uint*_t */
+
+#include "query.h"	/* struct query */
+#include "stats.h"	/* struct stats */
+#include "store.h"	/* struct partition */
+
+/*
+ * Access path choice for one partition of a query. A partition is pruned
+ * when it's a typeID bucket (see shard.h) other than the query's, or when
+ * its stats prove nothing matches. Otherwise the zone map picks the
+ * row groups that may match, and the plan reads just those unless they
+ * are so many that a plain sequential scan is cheaper. Estimates assume
+ * the predicates are independent and values spread evenly within a
+ * histogram bucket.
+*/
+
+/* Cost of reading a kept row group on its own, in sequential groups. */
+#define PLAN_SKIP_COST 2
+
+enum plan_path {
+	PLAN_PRUNE = 0,		/* Nothing to read. */
+	PLAN_SCAN,		/* Read every row group. */
+	PLAN_SKIP		/* Read only the kept row groups. */
+};
+
+struct plan {
+	enum plan_path path;
+	uint64_t ngroups;
+	uint64_t kept;		/* Row groups the zone map can't rule out. */
+	double est;		/* Estimated matching rows. */
+};
+
+/*
+ * Plans q over p, whose stats are st (NULL if it has none, which means a
+ * full scan). keep gets scan_ngroups(p) bytes, for scan_open().
+*/
+void
+plan_partition(struct plan *pl, const struct partition *p,
+    const struct stats *st, const struct query *q, uint8_t *keep);
+
+const char *
+plan_path_name(enum plan_path path);
+
+#endif
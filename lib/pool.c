@@ -0,0 +1,299 @@
+#include "pool.h"
+
+#include <stdlib.h>	/* malloc(), getenv() */
+#include <unistd.h>	/* sysconf() */
+#include <assert.h>	/* assert() */
+
+/* The worker running on this thread, NULL outside the pool. */
+static __thread struct pool_worker *self;
+
+static int
+deque_init(struct pool_deque *d)
+{
+	d->cap = 64;
+	d->head = d->tail = 0;
+	if ((d->buf = malloc(sizeof(*d->buf) * d->cap)) == NULL) {
+		return 1;
+	}
+	pthread_mutex_init(&d->lock, NULL);
+	return 0;
+}
+
+static void
+deque_free(struct pool_deque *d)
+{
+	pthread_mutex_destroy(&d->lock);
+	free(d->buf);
+	return;
+}
+
+static int
+deque_push(struct pool_deque *d, const struct pool_task *t)
+{
+	pthread_mutex_lock(&d->lock);
+	if (d->tail - d->head == d->cap) { /* Grow, unrolling the ring. */
+		struct pool_task *buf = malloc(sizeof(*buf) * d->cap * 2);
+		size_t i;
+		if (buf == NULL) {
+			pthread_mutex_unlock(&d->lock);
+			return 1;
+		}
+		for (i = d->head; i != d->tail; ++i) {
+			buf[i - d->head] = d->buf[i & (d->cap - 1)];
+		}
+		free(d->buf);
+		d->buf = buf;
+		d->tail -= d->head;
+		d->head = 0;
+		d->cap *= 2;
+	}
+	d->buf[d->tail++ & (d->cap - 1)] = *t;
+	pthread_mutex_unlock(&d->lock);
+	return 0;
+}
+
+/* The owner takes the newest task, thieves the oldest. */
+static int
+deque_take(struct pool_deque *d, struct pool_task *t, int steal)
+{
+	int found = 0;
+	pthread_mutex_lock(&d->lock);
+	if (d->head != d->tail) {
+		*t = steal ? d->buf[d->head++ & (d->cap - 1)]
+		    : d->buf[--d->tail & (d->cap - 1)];
+		found = 1;
+	}
+	pthread_mutex_unlock(&d->lock);
+	return found;
+}
+
+/* Finds a task of priority prio, own deque first. */
+static int
+find_prio(struct pool *p, enum pool_prio prio, struct pool_task *t)
+{
+	unsigned int i, start;
+	const int mine = self != NULL && self->pool == p;
+	if (mine && deque_take(&self->dq[prio], t, 0)) {
+		return 1;
+	}
+	/* Steal, starting after ourselves so thieves spread out. */
+	start = mine ? (unsigned int)(self - p->workers) + 1 : 0;
+	for (i = 0; i < p->nworkers; ++i) {
+		struct pool_worker *w = &p->workers[(start + i) % p->nworkers];
+		if (deque_take(&w->dq[prio], t, 1)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int
+find_task(struct pool *p, struct pool_task *t)
+{
+	int prio;
+	for (prio = POOL_HIGH; prio < POOL_NPRIO; ++prio) {
+		if (find_prio(p, (enum pool_prio)prio, t)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void
+run_task(struct pool *p, const struct pool_task *t)
+{
+	pthread_mutex_lock(&p->lock);
+	p->queued--;
+	pthread_mutex_unlock(&p->lock);
+	t->fn(t->arg);
+	if (t->group != NULL) {
+		pthread_mutex_lock(&p->lock);
+		if (--t->group->pending == 0) {
+			pthread_cond_broadcast(&p->done);
+		}
+		pthread_mutex_unlock(&p->lock);
+	}
+	return;
+}
+
+static void *
+worker_main(void *arg)
+{
+	struct pool_worker *w = arg;
+	struct pool *p = w->pool;
+	struct pool_task t;
+	self = w;
+	for (;;) {
+		if (find_task(p, &t)) {
+			run_task(p, &t);
+			continue;
+		}
+		pthread_mutex_lock(&p->lock);
+		while (p->queued == 0 && !p->stop) {
+			pthread_cond_wait(&p->wake, &p->lock);
+		}
+		if (p->queued == 0 && p->stop) {
+			pthread_mutex_unlock(&p->lock);
+			return NULL;
+		}
+		pthread_mutex_unlock(&p->lock);
+	}
+}
+
+int
+pool_init(struct pool *p, unsigned int nworkers)
+{
+	unsigned int i;
+	int prio;
+	{ /* Preconditions */
+		assert(p != NULL);
+	}
+	if (nworkers == 0) {
+		const char *env = getenv("EVE_THREADS");
+		const long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		nworkers = env ? (unsigned int)atoi(env) : 0;
+		if (nworkers == 0) {
+			nworkers = ncpu > 0 ? (unsigned int)ncpu : 1;
+		}
+	}
+	if ((p->workers = calloc(nworkers, sizeof(*p->workers))) == NULL) {
+		return 1;
+	}
+	p->nworkers = nworkers;
+	p->queued = 0;
+	p->next = 0;
+	p->stop = 0;
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->wake, NULL);
+	pthread_cond_init(&p->done, NULL);
+	/* All deques exist before any worker can try to steal from them. */
+	for (i = 0; i < nworkers; ++i) {
+		p->workers[i].pool = p;
+		for (prio = 0; prio < POOL_NPRIO; ++prio) {
+			if (deque_init(&p->workers[i].dq[prio])) {
+				goto fail;
+			}
+		}
+	}
+	for (i = 0; i < nworkers; ++i) {
+		if (pthread_create(&p->workers[i].tid, NULL, worker_main,
+		    &p->workers[i])) {
+			p->nworkers = i; /* Run with what we got. */
+			break;
+		}
+	}
+	return p->nworkers == 0;
+
+fail:
+	p->nworkers = i + 1;
+	for (i = 0; i < p->nworkers; ++i) {
+		for (prio = 0; prio < POOL_NPRIO; ++prio) {
+			free(p->workers[i].dq[prio].buf);
+		}
+	}
+	free(p->workers);
+	return 1;
+}
+
+void
+pool_free(struct pool *p)
+{
+	unsigned int i;
+	int prio;
+	pthread_mutex_lock(&p->lock);
+	p->stop = 1;
+	pthread_cond_broadcast(&p->wake);
+	pthread_mutex_unlock(&p->lock);
+	for (i = 0; i < p->nworkers; ++i) {
+		pthread_join(p->workers[i].tid, NULL);
+	}
+	/* Only now, as running workers steal from every deque. */
+	for (i = 0; i < p->nworkers; ++i) {
+		for (prio = 0; prio < POOL_NPRIO; ++prio) {
+			deque_free(&p->workers[i].dq[prio]);
+		}
+	}
+	pthread_mutex_destroy(&p->lock);
+	pthread_cond_destroy(&p->wake);
+	pthread_cond_destroy(&p->done);
+	free(p->workers);
+	return;
+}
+
+int
+pool_submit(struct pool *p, enum pool_prio prio, pool_fn fn, void *arg,
+    struct pool_group *group)
+{
+	struct pool_task t;
+	struct pool_worker *w;
+	{ /* Preconditions */
+		assert(p != NULL);
+		assert(fn != NULL);
+	}
+	t.fn = fn;
+	t.arg = arg;
+	t.group = group;
+	pthread_mutex_lock(&p->lock);
+	w = (self != NULL && self->pool == p) ? self
+	    : &p->workers[p->next++ % p->nworkers];
+	if (group != NULL) {
+		group->pending++;
+	}
+	p->queued++;
+	pthread_mutex_unlock(&p->lock);
+	if (deque_push(&w->dq[prio], &t)) {
+		pthread_mutex_lock(&p->lock);
+		if (group != NULL) {
+			group->pending--;
+		}
+		p->queued--;
+		pthread_mutex_unlock(&p->lock);
+		return 1;
+	}
+	pthread_mutex_lock(&p->lock);
+	pthread_cond_signal(&p->wake);
+	pthread_mutex_unlock(&p->lock);
+	return 0;
+}
+
+void
+pool_wait(struct pool *p, struct pool_group *group)
+{
+	struct pool_task t;
+	for (;;) {
+		pthread_mutex_lock(&p->lock);
+		if (group->pending == 0) {
+			pthread_mutex_unlock(&p->lock);
+			return;
+		}
+		pthread_mutex_unlock(&p->lock);
+		/* Workers help out instead of blocking. */
+		if (pool_self(p) != -1 && find_task(p, &t)) {
+			run_task(p, &t);
+			continue;
+		}
+		pthread_mutex_lock(&p->lock);
+		if (group->pending != 0) {
+			pthread_cond_wait(&p->done, &p->lock);
+		}
+		pthread_mutex_unlock(&p->lock);
+	}
+}
+
+int
+pool_self(const struct pool *p)
+{
+	return (self != NULL && self->pool == p)
+	    ? (int)(self - p->workers) : -1;
+}
+
+int
+pool_yield(struct pool *p)
+{
+	struct pool_task t;
+	if (pool_self(p) == -1 || !find_prio(p, POOL_HIGH, &t)) {
+		return 0;
+	}
+	run_task(p, &t);
+	return 1;
+}
@@ -0,0 +1,99 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <pthread.h>	/* pthread_t, pthread_mutex_t */
+#include <stddef.h>	/* size_t */
+
+/*
+ * The one thread pool everything parallel runs on: inflating, parsing,
+ * compression, compaction and query morsels. Sharing it keeps the machine
+ * from being oversubscribed when ingest and queries overlap.
+ *
+ * Every worker owns a deque per priority. A worker pops its own newest
+ * task first (it's cache-hot) and otherwise steals the oldest task of
+ * another worker. POOL_HIGH work (queries) always goes before POOL_LOW
+ * work (background compaction), and long POOL_LOW tasks should call
+ * pool_yield() now and then so a query arriving mid-task isn't stuck
+ * behind it.
+*/
+
+enum pool_prio {
+	POOL_HIGH = 0,
+	POOL_LOW,
+	POOL_NPRIO
+};
+
+typedef void (*pool_fn)(void *arg);
+
+/* Tasks submitted with a group can be waited on together. */
+struct pool_group {
+	unsigned long pending;
+};
+
+struct pool_task {
+	pool_fn fn;
+	void *arg;
+	struct pool_group *group;
+};
+
+struct pool_deque {
+	pthread_mutex_t lock;
+	struct pool_task *buf;
+	size_t head;	/* Oldest task, where thieves take from. */
+	size_t tail;	/* One past the newest, where the owner works. */
+	size_t cap;	/* Power of two. */
+};
+
+struct pool_worker {
+	struct pool *pool;
+	pthread_t tid;
+	struct pool_deque dq[POOL_NPRIO];
+};
+
+struct pool {
+	unsigned int nworkers;
+	struct pool_worker *workers;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;	/* Tasks queued or stopping. */
+	pthread_cond_t done;	/* Some group finished. */
+	unsigned long queued;	/* Tasks in all deques, under lock. */
+	unsigned int next;	/* Round robin for outside submitters. */
+	int stop;
+};
+
+/*
+ * Starts nworkers threads; 0 means EVE_THREADS, or one per online CPU.
+ * Workers inherit the caller's CPU affinity. Returns 0 on success.
+*/
+int
+pool_init(struct pool *p, unsigned int nworkers);
+
+/* Finishes every queued task, then stops the workers. */
+void
+pool_free(struct pool *p);
+
+/* group may be NULL. Returns 0 on success, 1 if out of memory. */
+int
+pool_submit(struct pool *p, enum pool_prio prio, pool_fn fn, void *arg,
+    struct pool_group *group);
+
+/*
+ * A worker runs tasks while it waits, so it's safe to call from inside a
+ * task. Other threads just wait, so no more than nworkers threads ever
+ * run tasks, however many threads submit them.
+*/
+void
+pool_wait(struct pool *p, struct pool_group *group);
+
+/* Returns which of p's workers is calling, or -1 if none is. */
+int
+pool_self(const struct pool *p);
+
+/*
+ * Runs one pending POOL_HIGH task, if any and if called from a worker.
+ * Returns 1 if it ran one.
+*/
+int
+pool_yield(struct pool *p);
+
+#endif
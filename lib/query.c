@@ -0,0 +1,358 @@
+#include "query.h"
+
+#include <stdio.h>	/* printf() */
+#include <stdlib.h>	/* qsort(), calloc(), free() */
+#include <assert.h>	/* assert() */
+
+#include "plan.h"
+#include "scan.h"
+
+/* Columns query_run() reads. */
+#define QUERY_COLS (COL_BIT(COL_ORDERID) | COL_BIT(COL_REGIONID) \
+	| COL_BIT(COL_TYPEID) | COL_BIT(COL_BID) | COL_BIT(COL_PRICE) \
+	| COL_BIT(COL_VOLREM) | COL_BIT(COL_RTIME))
+
+void
+partial_init(struct partial *p)
+{
+	p->rows = p->scanned = p->volume = 0;
+	p->estimate = p->notional = 0;
+	p->minprice = UINT64_MAX;
+	p->maxprice = 0;
+	p->ntop = p->pad = 0;
+	hll_init(&p->orders);
+	return;
+}
+
+/* Keeps the k highest prices in a min-heap rooted at top[0]. */
+static void
+top_add(struct partial *p, uint64_t price, uint32_t k)
+{
+	uint32_t i, child;
+	if (p->ntop < k) { /* Sift up. */
+		for (i = p->ntop++; i > 0 && p->top[(i - 1) / 2] > price;
+		    i = (i - 1) / 2) {
+			p->top[i] = p->top[(i - 1) / 2];
+		}
+		p->top[i] = price;
+		return;
+	}
+	if (k == 0 || price <= p->top[0]) {
+		return;
+	}
+	for (i = 0; (child = 2 * i + 1) < p->ntop; i = child) { /* Sift down. */
+		if (child + 1 < p->ntop && p->top[child + 1] < p->top[child]) {
+			child++;
+		}
+		if (p->top[child] >= price) {
+			break;
+		}
+		p->top[i] = p->top[child];
+	}
+	p->top[i] = price;
+	return;
+}
+
+void
+partial_merge(struct partial *dst, const struct partial *src,
+    const struct query *q)
+{
+	uint32_t i;
+	dst->rows += src->rows;
+	dst->scanned += src->scanned;
+	dst->estimate += src->estimate;
+	dst->volume += src->volume;
+	dst->notional += src->notional;
+	if (src->minprice < dst->minprice) {
+		dst->minprice = src->minprice;
+	}
+	if (src->maxprice > dst->maxprice) {
+		dst->maxprice = src->maxprice;
+	}
+	for (i = 0; i < src->ntop && i < QUERY_TOPK; ++i) {
+		top_add(dst, src->top[i], q->topk);
+	}
+	hll_merge(&dst->orders, &src->orders);
+	return;
+}
+
+static int
+cmp_desc(const void *a, const void *b)
+{
+	const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return (x < y) - (x > y);
+}
+
+void
+partial_print(const struct partial *p)
+{
+	uint64_t top[QUERY_TOPK];
+	uint32_t i;
+	printf("rows %llu volume %llu distinct-orders %.0f\n",
+	    (unsigned long long)p->rows, (unsigned long long)p->volume,
+	    hll_count(&p->orders));
+	printf("estimate %.0f scanned %llu\n", p->estimate,
+	    (unsigned long long)p->scanned);
+	if (p->rows == 0) {
+		return;
+	}
+	printf("vwap %.2f min %.2f max %.2f\n",
+	    p->volume ? p->notional / (double)p->volume / 100.0 : 0.0,
+	    (double)p->minprice / 100.0, (double)p->maxprice / 100.0);
+	for (i = 0; i < p->ntop; ++i) {
+		top[i] = p->top[i];
+	}
+	qsort(top, p->ntop, sizeof(top[0]), cmp_desc);
+	for (i = 0; i < p->ntop; ++i) {
+		printf("top %u %.2f\n", i + 1, (double)top[i] / 100.0);
+	}
+	return;
+}
+
+/* Whether row i of b passes q's filters. */
+static inline int
+match(const struct query *q, const struct scan_batch *b, size_t i)
+{
+	const uint32_t *regionID = b->col[COL_REGIONID];
+	const uint32_t *typeID = b->col[COL_TYPEID];
+	const uint8_t *bid = b->col[COL_BID];
+	const uint32_t *rtime = b->col[COL_RTIME];
+	const uint32_t to = q->to ? q->to : UINT32_MAX;
+	return !((q->typeID && typeID[i] != q->typeID)
+	    || (q->regionID && regionID[i] != q->regionID)
+	    || (q->bid >= 0 && bid[i] != (uint8_t)q->bid)
+	    || rtime[i] < q->from || rtime[i] >= to);
+}
+
+/* Aggregates the rows of one batch that pass q. */
+static void
+query_batch(const struct query *q, const struct scan_batch *b,
+    struct partial *out)
+{
+	const uint64_t *orderID = b->col[COL_ORDERID];
+	const uint64_t *price = b->col[COL_PRICE];
+	const uint32_t *volRem = b->col[COL_VOLREM];
+	size_t i;
+	for (i = 0; i < b->n; ++i) {
+		if (!match(q, b, i)) {
+			continue;
+		}
+		out->rows++;
+		out->volume += volRem[i];
+		out->notional += (double)price[i] * volRem[i];
+		if (price[i] < out->minprice) {
+			out->minprice = price[i];
+		}
+		if (price[i] > out->maxprice) {
+			out->maxprice = price[i];
+		}
+		top_add(out, price[i], q->topk);
+		hll_add(&out->orders, orderID[i]);
+	}
+	return;
+}
+
+size_t
+query_select(const struct query *q, const struct scan_batch *b,
+    size_t first, size_t max, uint32_t *sel)
+{
+	size_t i, n = 0;
+	{ /* Preconditions */
+		assert(q != NULL);
+		assert(b != NULL);
+		assert(sel != NULL || max == 0);
+	}
+	for (i = first; i < b->n && n < max; ++i) {
+		if (match(q, b, i)) {
+			sel[n++] = (uint32_t)i;
+		}
+	}
+	return n;
+}
+
+/*
+ * Runs q over p into out, as planned into pl; *rows gets the rows it
+ * matched. Scratch memory comes from a. Returns 0 on success.
+*/
+static int
+run_partition(const struct partition *p, const struct query *q,
+    struct partial *out, struct arena *a, struct plan *pl, uint64_t *rows)
+{
+	const uint64_t before = out->rows;
+	struct scan scan;
+	struct scan_batch b;
+	struct stats st;
+	uint8_t *keep;
+	int rc;
+	arena_reset(a);
+	if ((keep = arena_alloc(a, scan_ngroups(p) + 1)) == NULL) {
+		return 1;
+	}
+	plan_partition(pl, p, stats_load(&st, p, a) ? NULL : &st, q, keep);
+	out->estimate += pl->est;
+	if (pl->path != PLAN_PRUNE) {
+		if (scan_open(&scan, p, QUERY_COLS,
+		    pl->path == PLAN_SKIP ? keep : NULL, 0, a)) {
+			return 1;
+		}
+		while ((rc = scan_next(&scan, &b)) == 0) {
+			out->scanned += b.n;
+			query_batch(q, &b, out);
+		}
+		scan_close(&scan);
+		if (rc < 0) {
+			return 1;
+		}
+	}
+	*rows = out->rows - before;
+	return 0;
+}
+
+static void
+explain(const struct partition *p, const struct plan *pl, uint64_t rows)
+{
+	printf("plan %s %s groups %llu/%llu est %.0f actual %llu\n", p->dir,
+	    plan_path_name(pl->path), (unsigned long long)pl->kept,
+	    (unsigned long long)pl->ngroups, pl->est,
+	    (unsigned long long)rows);
+}
+
+int
+query_run(const struct store *s, const struct query *q,
+    struct partial *out, struct arena *a)
+{
+	struct plan pl;
+	uint64_t rows;
+	unsigned int i;
+	{ /* Preconditions */
+		assert(s != NULL);
+		assert(q != NULL);
+		assert(q->topk <= QUERY_TOPK);
+	}
+	for (i = 0; i < s->nparts; ++i) {
+		if (run_partition(&s->parts[i], q, out, a, &pl, &rows)) {
+			return 1;
+		}
+		if (q->flags & QUERY_EXPLAIN) {
+			explain(&s->parts[i], &pl, rows);
+		}
+	}
+	return 0;
+}
+
+struct arena *
+query_scratch(const struct pool *pool, size_t size)
+{
+	struct arena *scratch;
+	unsigned int i;
+	{ /* Preconditions */
+		assert(pool != NULL);
+	}
+	if ((scratch = calloc(pool->nworkers, sizeof(*scratch))) == NULL) {
+		return NULL;
+	}
+	for (i = 0; i < pool->nworkers; ++i) {
+		if (arena_init(&scratch[i], size, MEM_QUERY)) {
+			while (i-- > 0) {
+				arena_free(&scratch[i]);
+			}
+			free(scratch);
+			return NULL;
+		}
+	}
+	return scratch;
+}
+
+void
+query_scratch_free(struct arena *scratch, const struct pool *pool)
+{
+	unsigned int i;
+	for (i = 0; scratch != NULL && i < pool->nworkers; ++i) {
+		arena_free(&scratch[i]);
+	}
+	free(scratch);
+	return;
+}
+
+/* A query_run_pool() task: takes partitions until there are none left. */
+struct morsels {
+	const struct store *s;
+	const struct query *q;
+	unsigned int *next;	/* Partition to take, shared. */
+	struct plan *plans;	/* Per partition, for QUERY_EXPLAIN. */
+	uint64_t *rows;
+	struct pool *pool;
+	struct arena *scratch;	/* Per worker. */
+	struct partial out;
+	int rc;
+};
+
+static void
+run_morsels(void *arg)
+{
+	struct morsels *m = arg;
+	const int w = pool_self(m->pool);
+	unsigned int i;
+	/* Only workers run tasks, and a morsel never waits for another. */
+	assert(w != -1);
+	while ((i = __atomic_fetch_add(m->next, 1, __ATOMIC_RELAXED))
+	    < m->s->nparts && !m->rc) {
+		m->rc = run_partition(&m->s->parts[i], m->q, &m->out,
+		    &m->scratch[w], &m->plans[i], &m->rows[i]);
+	}
+}
+
+int
+query_run_pool(const struct store *s, const struct query *q,
+    struct partial *out, struct pool *pool, struct arena *scratch)
+{
+	const unsigned int ntasks = (s->nparts < pool->nworkers)
+	    ? s->nparts : pool->nworkers;
+	struct pool_group group = { 0 };
+	struct morsels *m;
+	struct plan *plans;
+	uint64_t *rows;
+	unsigned int next = 0, i, n;
+	int rc = 0;
+	{ /* Preconditions */
+		assert(s != NULL);
+		assert(q != NULL);
+		assert(q->topk <= QUERY_TOPK);
+		assert(pool != NULL);
+		assert(scratch != NULL);
+	}
+	m = calloc(ntasks + 1, sizeof(*m));
+	plans = calloc(s->nparts + 1, sizeof(*plans));
+	rows = calloc(s->nparts + 1, sizeof(*rows));
+	if (m == NULL || plans == NULL || rows == NULL) {
+		rc = 1;
+		goto out;
+	}
+	for (i = 0; i < ntasks; ++i) {
+		m[i].s = s;
+		m[i].q = q;
+		m[i].next = &next;
+		m[i].plans = plans;
+		m[i].rows = rows;
+		m[i].pool = pool;
+		m[i].scratch = scratch;
+		partial_init(&m[i].out);
+		if (pool_submit(pool, POOL_HIGH, run_morsels, &m[i], &group)) {
+			rc = 1;
+			break;
+		}
+	}
+	pool_wait(pool, &group);
+	for (n = i, i = 0; i < n; ++i) {
+		rc |= m[i].rc;
+		partial_merge(out, &m[i].out, q);
+	}
+	for (i = 0; i < s->nparts && !rc && (q->flags & QUERY_EXPLAIN); ++i) {
+		explain(&s->parts[i], &plans[i], rows[i]);
+	}
+out:
+	free(m);
+	free(plans);
+	free(rows);
+	return rc;
+}
@@ -0,0 +1,118 @@
+#ifndef QUERY_H_
+#define QUERY_H_
+
+#include <stddef.h>	/* size_t */
+#include <stdint.h>	/* uint*_t */
+
+#include "arena.h"	/* struct arena */
+#include "hll.h"	/* struct hll */
+#include "pool.h"	/* struct pool */
+#include "store.h"	/* struct store */
+
+/*
+ * Filtered aggregation over a store, the query every tool speaks.
+ *
+ * A query's result is a partial aggregate: everything in it (counts,
+ * sums, VWAP components, a distinct-order sketch, a top-k of prices)
+ * merges associatively. So a store can be split across processes or
+ * hosts, each answering for its own part, and a coordinator combining
+ * the partials gets the same answer as one big scan. Both structs go over
+ * the wire as-is; every shard is assumed to share the coordinator's
+ * architecture, as with the files the converter writes.
+*/
+
+#define QUERY_TOPK 16
+
+/* Columns a query reads to filter rows, see query_select(). */
+#define QUERY_FILTER_COLS (COL_BIT(COL_REGIONID) | COL_BIT(COL_TYPEID) \
+	| COL_BIT(COL_BID) | COL_BIT(COL_RTIME))
+
+/* Query flags. */
+#define QUERY_EXPLAIN 1	/* Print each partition's plan and row counts. */
+
+struct query {
+	uint32_t typeID;	/* 0 matches any. */
+	uint32_t regionID;	/* 0 matches any. */
+	uint32_t from;		/* rtime >= from. */
+	uint32_t to;		/* rtime < to, 0 means no upper bound. */
+	int32_t bid;		/* 0 or 1, -1 matches both. */
+	uint32_t topk;		/* Highest prices to keep, <= QUERY_TOPK. */
+	uint32_t flags;
+};
+
+struct partial {
+	uint64_t rows;
+	uint64_t scanned;	/* Rows read to find them. */
+	double estimate;	/* What the planner expected rows to be. */
+	uint64_t volume;	/* Sum of volRem. */
+	double notional;	/* Sum of price * volRem, in cents. */
+	uint64_t minprice;
+	uint64_t maxprice;
+	uint32_t ntop;
+	uint32_t pad;
+	uint64_t top[QUERY_TOPK];	/* Min-heap of the highest prices. */
+	struct hll orders;		/* Distinct orderIDs. */
+};
+
+/* What a shard server sends back for each query it reads. */
+struct query_reply {
+	int32_t rc;		/* 0, or the shard failed to answer. */
+	uint32_t pad;
+	struct partial result;
+};
+
+void
+partial_init(struct partial *p);
+
+/* Folds src into dst. */
+void
+partial_merge(struct partial *dst, const struct partial *src,
+    const struct query *q);
+
+/* Prints the result in a fixed text form. */
+void
+partial_print(const struct partial *p);
+
+struct scan_batch;
+
+/*
+ * Rows of b from row first on that pass q's filters, at most max of them,
+ * into sel (by row number). b holds QUERY_FILTER_COLS. Returns how many;
+ * fewer than max means the rest of b didn't match.
+*/
+size_t
+query_select(const struct query *q, const struct scan_batch *b,
+    size_t first, size_t max, uint32_t *sel);
+
+/*
+ * Runs q over every partition of s into out, as planned from each one's
+ * stats (see plan.h). Scratch memory comes from a (reset per partition).
+ * Returns 0 on success.
+*/
+int
+query_run(const struct store *s, const struct query *q,
+    struct partial *out, struct arena *a);
+
+/*
+ * Scratch for query_run_pool(): an arena of size bytes for each of the
+ * pool's workers, made once rather than per query. Returns NULL on
+ * failure.
+*/
+struct arena *
+query_scratch(const struct pool *pool, size_t size);
+
+void
+query_scratch_free(struct arena *scratch, const struct pool *pool);
+
+/*
+ * As query_run(), but on the pool's workers as POOL_HIGH tasks, each
+ * taking a partition at a time with its own partial, merged into out at
+ * the end. A task uses its worker's arena of scratch, from
+ * query_scratch(), so any number of threads can run queries on one pool.
+ * Plans are printed after, in partition order.
+*/
+int
+query_run_pool(const struct store *s, const struct query *q,
+    struct partial *out, struct pool *pool, struct arena *scratch);
+
+#endif
@@ -1,20 +1,31 @@
 #include "queue.h"
 
-#define HEADERSIZE 2
+#include <stdio.h>	/* perror() */
 
-int
-queue_init(struct queue *q, int fd, unsigned int size, unsigned int bufCount)
+#include "crc32c.h"
+
+/*
+ * Page layout: a big-endian 16 bit count of the elements in the page, a
+ * big-endian CRC-32C of the rest of the page (count included), then lz4
+ * blocks, each behind a big-endian 16 bit compressed length. Blocks hold
+ * whole elements. The rest of the page is padding.
+*/
+#define HEADERSIZE 6
+#define BLOCKHEADERSIZE 2
+#define CRCOFFSET 2
+
+/* Checksum of a page, all of it but the checksum itself. */
+static uint32_t
+page_crc(const char *page)
 {
-	assert(fd >= 0);
-	assert(size > 0);
-	assert(bufCount > 0);
+	return crc32c(crc32c(0, page, CRCOFFSET), page + HEADERSIZE,
+	    PAGESIZE - HEADERSIZE);
+}
 
-	if ((q->data = malloc(size * bufCount)) == NULL) {
-		return 1;
-	}
-	if ((q->page = malloc(PAGESIZE)) == NULL) {
-		return 1;
-	}
+/* Sets up everything but the buffers. */
+static void
+queue_setup(struct queue *q, int fd, unsigned int size, unsigned int bufCount)
+{
 	q->fd = fd;
 	q->dUse = q->pEleCount = 0;
 	q->dCap = bufCount;
@@ -25,27 +36,77 @@ queue_init(struct queue *q, int fd, unsigned int size, unsigned int bufCount)
 
 	assert(q->pUse <= q->pSize);
 	assert(q->dUse < q->dCap);
+}
+
+int
+queue_init(struct queue *q, int fd, unsigned int size, unsigned int bufCount)
+{
+	assert(fd >= 0);
+	assert(size > 0);
+	assert(bufCount > 0);
+
+	/* Large and streamed through, so it goes on huge pages if it can. */
+	q->data = mem_huge_alloc((size_t)size * bufCount, MEM_QUEUE);
+	if (q->data == NULL) {
+		return 1;
+	}
+	if ((q->page = mem_alloc(PAGESIZE, MEM_QUEUE)) == NULL) {
+		return 1;
+	}
+	q->arena = NULL;
+	queue_setup(q, fd, size, bufCount);
+	return 0;
+}
+
+int
+queue_init_arena(struct queue *q, int fd, unsigned int size,
+    unsigned int bufCount, struct arena *arena)
+{
+	assert(fd >= 0);
+	assert(size > 0);
+	assert(bufCount > 0);
+	assert(arena != NULL);
+
+	if ((q->data = arena_alloc(arena, (size_t)size * bufCount)) == NULL) {
+		return 1;
+	}
+	if ((q->page = arena_alloc(arena, PAGESIZE)) == NULL) {
+		return 1;
+	}
+	q->arena = arena;
+	queue_setup(q, fd, size, bufCount);
 	return 0;
 }
 
 void
 queue_free(struct queue *q)
 {
-	free(q->data);
-	free(q->page);
+	if (q->arena != NULL) { /* Reclaimed by arena_reset(). */
+		return;
+	}
+	mem_huge_free(q->data, (size_t)q->eleSize * q->dCap, MEM_QUEUE);
+	mem_free(q->page, PAGESIZE, MEM_QUEUE);
 	return;
 }
 
 int
 queue_write(struct queue *q)
 {
+	uint32_t crc;
 	assert(q->pUse <= q->pSize);
 
 	/* Write header and page, then reset pUse */
-	q->page[0] = (char)(q->pEleCount << 8);
-	q->page[1] = (char)(q->pEleCount << 0);
-	/* Add error handling. */
-	write(q->fd, q->page, q->pSize);
+	q->page[0] = (char)(q->pEleCount >> 8);
+	q->page[1] = (char)(q->pEleCount >> 0);
+	crc = page_crc(q->page);
+	q->page[2] = (char)(crc >> 24);
+	q->page[3] = (char)(crc >> 16);
+	q->page[4] = (char)(crc >> 8);
+	q->page[5] = (char)(crc >> 0);
+	if (write(q->fd, q->page, q->pSize) != (ssize_t)q->pSize) {
+		perror("write()");
+		return 1;
+	}
 	q->pUse = HEADERSIZE;
 	q->pEleCount = 0;
 
@@ -56,48 +117,62 @@ queue_write(struct queue *q)
 int
 queue_compress(struct queue *q)
 {
-	const unsigned int lower_limit = 11; /* Comes from lz4, refactor. */
+	/* Comes from lz4, refactor. */
+	const unsigned int lower_limit = 11 + BLOCKHEADERSIZE;
 	const unsigned int buffer_len = (q->dUse * q->eleSize);
-	int uc_bytes = buffer_len; /* Try to compress all buffer's bytes. */
+	/* The page header can't count past QUEUE_PAGEMAX. */
+	const unsigned int room = QUEUE_PAGEMAX - q->pEleCount;
+	char *const block = q->page + q->pUse + BLOCKHEADERSIZE;
+	/* Try to compress all buffer's bytes. */
+	int uc_bytes = (int)((q->dUse < room ? q->dUse : room) * q->eleSize);
 	uint16_t new_elements = 0;
+	int c_bytes;
 
+	if (q->dUse == 0) {
+		return 0;
+	}
+	if (room == 0) {
+		return queue_write(q) ? -1 : queue_compress(q);
+	}
 	/* Bytes taken in page by LZ4 compression. */
-	int c_bytes = LZ4_compress_destSize(q->data, q->page + q->pUse,
-		&uc_bytes, q->pSize - q->pUse);
+	c_bytes = LZ4_compress_destSize(q->data, block, &uc_bytes,
+		q->pSize - q->pUse - BLOCKHEADERSIZE);
 	if (c_bytes == 0) {
 		return -1;
 	}
 
-	if (uc_bytes < q->eleSize) {
-		/* Below, we try to estimate how much space we have to leave in the
-		 * buffer to ensure that we can keep compressing stuff. Sometimes
-		 * our estimate will be wrong, so we have to handle that case. */
-		queue_write(q);
-		return queue_compress(q);
-	}
-
 	/* We don't want our integers cut on page boundaries, So we tell lz4
 	 * that our buffer is only as long as the number of integers it can
-	 * successfully compress. */
-	if (uc_bytes % q->eleSize != 0) {
+	 * successfully compress. lz4 may take less of the shorter input than
+	 * it was given, so repeat until a block ends on an element. */
+	while ((unsigned int)uc_bytes >= q->eleSize
+	    && uc_bytes % q->eleSize != 0) {
 		uc_bytes -= uc_bytes % q->eleSize;
-		c_bytes = LZ4_compress_destSize(q->data, q->page + q->pUse,
-			&uc_bytes, q->pSize - q->pUse);
+		c_bytes = LZ4_compress_destSize(q->data, block, &uc_bytes,
+			q->pSize - q->pUse - BLOCKHEADERSIZE);
 		if (c_bytes == 0) {
 			return -1;
 		}
 	}
 
+	if ((unsigned int)uc_bytes < q->eleSize) {
+		/* Below, we try to estimate how much space we have to leave in the
+		 * buffer to ensure that we can keep compressing stuff. Sometimes
+		 * our estimate will be wrong, so we have to handle that case. */
+		return queue_write(q) ? -1 : queue_compress(q);
+	}
+
 	new_elements = (uint16_t)(uc_bytes / q->eleSize);
 	q->pEleCount += new_elements;
 	q->dUse -= new_elements;
-	q->pUse += c_bytes;
+	block[-2] = (char)(c_bytes >> 8);
+	block[-1] = (char)(c_bytes >> 0);
+	q->pUse += BLOCKHEADERSIZE + c_bytes;
 
+	memmove(q->data, (char *)q->data + uc_bytes, buffer_len - uc_bytes);
 	if (q->pSize - q->pUse <= lower_limit) {
-		queue_write(q);
+		return queue_write(q) ? -1 : 0;
 	}
-
-	memmove(q->data, (char *)q->data + uc_bytes, buffer_len - uc_bytes);
 	return 0;
 }
 
@@ -118,7 +193,8 @@ queue_push(struct queue *q, const void *data)
 int
 queue_commit(struct queue *q)
 {
-	if (q->dUse == 0 && q->pUse == 0) { /* All data has been flushed. */
+	/* All data has been flushed. */
+	if (q->dUse == 0 && q->pEleCount == 0) {
 		return 0;
 	}
 	if (q->dUse == 0) { /* All data is in the compressed buffer. */
@@ -134,3 +210,77 @@ queue_commit(struct queue *q)
 	}
 	return queue_commit(q);
 }
+
+void
+queue_page_open(struct queue_page *p, const char *page, unsigned int size)
+{
+	assert(page != NULL);
+	assert(size > 0);
+
+	p->page = page;
+	p->eleSize = size;
+	p->left = ((unsigned int)(unsigned char)page[0] << 8)
+		| (unsigned char)page[1];
+	p->pos = HEADERSIZE;
+}
+
+int
+queue_page_check(const char *page)
+{
+	const unsigned char *h = (const unsigned char *)page + CRCOFFSET;
+	const uint32_t crc = (uint32_t)h[0] << 24 | (uint32_t)h[1] << 16
+	    | (uint32_t)h[2] << 8 | h[3];
+	assert(page != NULL);
+
+	return (crc == page_crc(page)) ? 0 : -1;
+}
+
+int
+queue_page_next(struct queue_page *p, void *out, int cap)
+{
+	unsigned int c_bytes;
+	int uc_bytes;
+
+	if (p->left == 0) {
+		return 0;
+	}
+	if (p->pos + BLOCKHEADERSIZE > PAGESIZE) {
+		return -1;
+	}
+	c_bytes = ((unsigned int)(unsigned char)p->page[p->pos] << 8)
+		| (unsigned char)p->page[p->pos + 1];
+	p->pos += BLOCKHEADERSIZE;
+	if (p->pos + c_bytes > PAGESIZE) {
+		return -1;
+	}
+	uc_bytes = LZ4_decompress_safe(p->page + p->pos, out, (int)c_bytes,
+		cap);
+	if (uc_bytes <= 0 || uc_bytes % p->eleSize != 0
+	    || (unsigned int)uc_bytes / p->eleSize > p->left) {
+		return -1;
+	}
+	p->pos += c_bytes;
+	p->left -= (unsigned int)uc_bytes / p->eleSize;
+	return uc_bytes;
+}
+
+unsigned int
+queue_block_count(unsigned int size)
+{
+	assert(size > 0);
+
+	return (size < QUEUE_BLOCK) ? QUEUE_BLOCK / size : 1;
+}
+
+int
+queue_page_each(struct queue_page *p, void *buf, int cap, queue_block_fn fn,
+    void *arg)
+{
+	int n, rc;
+	while ((n = queue_page_next(p, buf, cap)) > 0) {
+		if ((rc = fn(buf, (unsigned int)n / p->eleSize, arg)) != 0) {
+			return rc;
+		}
+	}
+	return n;
+}
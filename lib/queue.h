@@ -7,8 +7,12 @@
 #include <assert.h>	/* assert() */
 
 #include "lz4/lib/lz4.h"
+#include "mem.h"
+#include "arena.h"
 
 #define PAGESIZE 16384
+#define QUEUE_PAGEMAX 65535 /* Elements per page, for the 16 bit header. */
+#define QUEUE_BLOCK 4096 /* Bytes per block that a reader keeps in L1. */
 
 struct queue {
 	char *page;
@@ -20,11 +24,21 @@ struct queue {
 	unsigned int pUse;
 	unsigned int pSize;
 	unsigned int pEleCount;
+	struct arena *arena; /* Owner of data and page, NULL if we own them. */
 };
 
 int
 queue_init(struct queue *q, int fd, unsigned int size, unsigned int bufCount);
 
+/*
+ * Like queue_init(), but carves the buffers out of arena, so opening a
+ * queue per dump or per spill doesn't touch the heap. queue_free() then
+ * leaves the memory to the arena's next reset.
+*/
+int
+queue_init_arena(struct queue *q, int fd, unsigned int size,
+    unsigned int bufCount, struct arena *arena);
+
 void
 queue_free(struct queue *q);
 
@@ -41,4 +55,54 @@ queue_push(struct queue *q, const void *data);
 int
 queue_commit(struct queue *q);
 
+/*
+ * Reading pages back. A block never decompresses to more than the writer's
+ * bufCount elements.
+*/
+struct queue_page {
+	const char *page;
+	unsigned int eleSize;
+	unsigned int left; /* Elements in blocks not read yet. */
+	unsigned int pos;
+};
+
+void
+queue_page_open(struct queue_page *p, const char *page, unsigned int size);
+
+/*
+ * Checks a page against the CRC-32C in its header, without decompressing
+ * anything. Returns 0 if it matches, -1 if the page is corrupt. Reading
+ * doesn't check; a corrupt page is only caught when lz4 chokes on it.
+*/
+int
+queue_page_check(const char *page);
+
+/*
+ * Decompresses the next block into out, of cap bytes. Returns its size in
+ * bytes, 0 at the end of the page, or -1 if the page is corrupt.
+*/
+int
+queue_page_next(struct queue_page *p, void *out, int cap);
+
+/*
+ * bufCount for blocks of about QUEUE_BLOCK bytes. A page can inflate to
+ * far more than PAGESIZE (a megabyte of runs), so readers that filter or
+ * aggregate should take it a block at a time, see queue_page_each().
+*/
+unsigned int
+queue_block_count(unsigned int size);
+
+/* Gets n elements of a block, still in cache. Nonzero stops the page. */
+typedef int (*queue_block_fn)(const void *block, unsigned int n, void *arg);
+
+/*
+ * Decompresses the rest of the page one block at a time into buf, of cap
+ * bytes, and hands each block to fn before decoding the next, so a small
+ * buf is reused from L1. Returns 0 at the end of the page, -1 if it's
+ * corrupt, or what fn returned to stop.
+*/
+int
+queue_page_each(struct queue_page *p, void *buf, int cap, queue_block_fn fn,
+    void *arg);
+
 #endif
@@ -0,0 +1,84 @@
+#include "rcu.h"
+
+#include <string.h>	/* memset() */
+#include <sched.h>	/* sched_yield() */
+#include <assert.h>	/* assert() */
+
+void
+rcu_init(struct rcu *r, void *p)
+{
+	{ /* Preconditions */
+		assert(r != NULL);
+	}
+	memset(r->readers, 0, sizeof(r->readers));
+	r->cur = p;
+	r->gp = 1; /* Slots hold 0 outside read sections. */
+	pthread_mutex_init(&r->lock, NULL);
+}
+
+int
+rcu_register(struct rcu *r)
+{
+	int i, none;
+	for (i = 0; i < RCU_READERS; ++i) {
+		none = 0;
+		if (__atomic_compare_exchange_n(&r->readers[i].used, &none, 1,
+		    0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+void
+rcu_unregister(struct rcu *r, int slot)
+{
+	assert(slot >= 0 && slot < RCU_READERS);
+	assert(r->readers[slot].gp == 0);
+
+	__atomic_store_n(&r->readers[slot].used, 0, __ATOMIC_RELEASE);
+}
+
+void *
+rcu_read_lock(struct rcu *r, int slot)
+{
+	struct rcu_reader *const rd = &r->readers[slot];
+	assert(slot >= 0 && slot < RCU_READERS);
+	assert(rd->gp == 0);
+
+	/*
+	 * Sequentially consistent, so the writer either sees our slot set
+	 * before it checks it, or swapped the pointer before we load it.
+	*/
+	__atomic_store_n(&rd->gp, __atomic_load_n(&r->gp, __ATOMIC_SEQ_CST),
+	    __ATOMIC_SEQ_CST);
+	return __atomic_load_n(&r->cur, __ATOMIC_SEQ_CST);
+}
+
+void
+rcu_read_unlock(struct rcu *r, int slot)
+{
+	assert(slot >= 0 && slot < RCU_READERS);
+
+	__atomic_store_n(&r->readers[slot].gp, 0, __ATOMIC_RELEASE);
+}
+
+void *
+rcu_replace(struct rcu *r, void *p)
+{
+	void *old;
+	uint64_t gp, seen;
+	int i;
+	pthread_mutex_lock(&r->lock);
+	old = __atomic_exchange_n(&r->cur, p, __ATOMIC_SEQ_CST);
+	gp = __atomic_add_fetch(&r->gp, 1, __ATOMIC_SEQ_CST);
+	for (i = 0; i < RCU_READERS; ++i) {
+		/* Entered before the new grace period: may hold old. */
+		while ((seen = __atomic_load_n(&r->readers[i].gp,
+		    __ATOMIC_SEQ_CST)) != 0 && seen < gp) {
+			sched_yield();
+		}
+	}
+	pthread_mutex_unlock(&r->lock);
+	return old;
+}
@@ -0,0 +1,61 @@
+#ifndef RCU_H_
+#define RCU_H_
+
+#include <stdint.h>	/* uint*_t */
+#include <pthread.h>	/* pthread_mutex_t */
+
+/*
+ * Read-copy-update of one pointer, for state that many threads read and
+ * one rebuilds now and then (see marketd.c).
+ *
+ * A reader thread registers once for a slot. Entering a read section
+ * stores the current grace period in the slot and loads the pointer;
+ * leaving it clears the slot. Neither ever waits, whatever the writer is
+ * doing. The writer swaps the pointer, starts a new grace period, and
+ * waits until every slot is clear or has entered since; then nobody can
+ * still hold the old pointer and the writer may free it.
+ *
+ * Read sections don't nest, and mustn't block on anything a writer could
+ * be waiting for.
+*/
+
+#define RCU_READERS 1024
+#define RCU_LINE 64
+
+struct rcu_reader {
+	uint64_t gp __attribute__((aligned(RCU_LINE))); /* 0 outside. */
+	int used;
+};
+
+struct rcu {
+	void *cur;
+	uint64_t gp;
+	pthread_mutex_t lock;	/* Writers, one at a time. */
+	struct rcu_reader readers[RCU_READERS];
+};
+
+void
+rcu_init(struct rcu *r, void *p);
+
+/* Returns a reader slot, or -1 if all RCU_READERS are taken. */
+int
+rcu_register(struct rcu *r);
+
+void
+rcu_unregister(struct rcu *r, int slot);
+
+/* Returns the pointer, valid until rcu_read_unlock(). */
+void *
+rcu_read_lock(struct rcu *r, int slot);
+
+void
+rcu_read_unlock(struct rcu *r, int slot);
+
+/*
+ * Publishes p and waits out every reader that may have seen the old
+ * pointer, which is returned for the caller to free.
+*/
+void *
+rcu_replace(struct rcu *r, void *p);
+
+#endif
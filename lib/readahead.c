@@ -0,0 +1,64 @@
+#include "readahead.h"
+
+#include <stdlib.h>	/* getenv(), atoi() */
+#include <fcntl.h>	/* posix_fadvise() */
+#include <unistd.h>	/* pread() */
+#include <assert.h>	/* assert() */
+
+#define DEFAULT_DEPTH 8
+
+void
+ra_init(struct readahead *ra, int fd, const struct extent *ext, size_t n,
+    unsigned int depth)
+{
+	{ /* Preconditions */
+		assert(ra != NULL);
+		assert(ext != NULL || n == 0);
+	}
+	if (depth == 0) {
+		const char *env = getenv("EVE_READAHEAD");
+		depth = env ? (unsigned int)atoi(env) : DEFAULT_DEPTH;
+		depth = depth ? depth : DEFAULT_DEPTH;
+	}
+	ra->fd = fd;
+	ra->ext = ext;
+	ra->n = n;
+	ra->next = ra->advised = 0;
+	ra->depth = depth;
+	/* We schedule the I/O ourselves; the kernel's own guess only wastes
+	 * bandwidth on pruned row groups. */
+	posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+	return;
+}
+
+ssize_t
+ra_next(struct readahead *ra, void *buf)
+{
+	const struct extent *e;
+	const size_t window = ra->next + ra->depth;
+	size_t got = 0;
+	ssize_t rb;
+	if (ra->next == ra->n) {
+		return 0;
+	}
+	/* Top up the window. Adjacent extents go out as one advice. */
+	while (ra->advised < ra->n && ra->advised < window) {
+		off_t off = ra->ext[ra->advised].off;
+		off_t end = off + (off_t)ra->ext[ra->advised].len;
+		while (++ra->advised < ra->n && ra->advised < window
+		    && ra->ext[ra->advised].off == end) {
+			end += (off_t)ra->ext[ra->advised].len;
+		}
+		posix_fadvise(ra->fd, off, end - off, POSIX_FADV_WILLNEED);
+	}
+	e = &ra->ext[ra->next++];
+	while (got < e->len) {
+		rb = pread(ra->fd, (char *)buf + got, e->len - got,
+		    e->off + (off_t)got);
+		if (rb <= 0) {
+			return -1; /* Short file or I/O error. */
+		}
+		got += (size_t)rb;
+	}
+	return (ssize_t)got;
+}
@@ -0,0 +1,47 @@
+#ifndef READAHEAD_H_
+#define READAHEAD_H_
+
+#include <stddef.h>	/* size_t */
+#include <sys/types.h>	/* off_t */
+
+/*
+ * Read-ahead scheduler for scans.
+ *
+ * A scan knows up front which byte ranges (extents) of a file it will
+ * read: the row groups its plan kept. Instead of stalling on each read,
+ * the scheduler keeps the next depth extents in flight with
+ * posix_fadvise(WILLNEED), which starts the disk I/O asynchronously, and
+ * reads each extent once the scan gets to it. Cold scans then run at disk
+ * speed rather than at one-read-at-a-time speed.
+*/
+
+struct extent {
+	off_t off;
+	size_t len;
+};
+
+struct readahead {
+	int fd;
+	const struct extent *ext;
+	size_t n;
+	size_t next;		/* Next extent to read. */
+	size_t advised;		/* Extents before this have been advised. */
+	unsigned int depth;
+};
+
+/*
+ * ext must stay valid until the scan is done. depth 0 means EVE_READAHEAD,
+ * or 8 extents.
+*/
+void
+ra_init(struct readahead *ra, int fd, const struct extent *ext, size_t n,
+    unsigned int depth);
+
+/*
+ * Reads the next extent into buf, which must hold its len bytes. Returns
+ * the bytes read, 0 once every extent was read, or -1 on errors.
+*/
+ssize_t
+ra_next(struct readahead *ra, void *buf);
+
+#endif
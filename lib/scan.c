@@ -0,0 +1,139 @@
+#include "scan.h"
+
+#include <stdio.h>	/* printf() */
+#include <string.h>	/* strerror() */
+#include <errno.h>	/* errno */
+#include <fcntl.h>	/* open() */
+#include <unistd.h>	/* close() */
+#include <assert.h>	/* assert() */
+
+uint64_t
+scan_ngroups(const struct partition *p)
+{
+	return (p->rows + SCAN_GROUP - 1) / SCAN_GROUP;
+}
+
+int
+scan_open(struct scan *s, const struct partition *p, unsigned int cols,
+    const uint8_t *keep, unsigned int depth, struct arena *a)
+{
+	const uint64_t ngroups = scan_ngroups(p);
+	char path[STORE_PATHLEN];
+	uint64_t g;
+	int c;
+	{ /* Preconditions */
+		assert(s != NULL);
+		assert(p != NULL);
+		assert(a != NULL);
+	}
+	s->part = p;
+	s->cols = cols;
+	s->ngroups = s->next = 0;
+	for (c = 0; c < NALLCOLS; ++c) {
+		s->fds[c] = -1;
+	}
+	s->groups = arena_alloc(a, sizeof(*s->groups) * (ngroups + 1));
+	if (s->groups == NULL) {
+		return 1;
+	}
+	for (g = 0; g < ngroups; ++g) {
+		if (keep == NULL || keep[g]) {
+			s->groups[s->ngroups++] = g;
+		}
+	}
+	/*
+	 * Partitions written before checksums can't be checked; ones whose
+	 * checksums are corrupt or stale can't be trusted.
+	*/
+	s->verify = 0;
+	if (checksum_on_read()) {
+		switch (checksum_load(&s->sums, p, a)) {
+		case CHECKSUM_OK:
+			s->verify = 1;
+			break;
+		case CHECKSUM_MISSING:
+			break;
+		default:
+			return 1;
+		}
+	}
+	for (c = 0; c < NALLCOLS; ++c) {
+		const size_t size = eve_col_sizes[c];
+		struct extent *ext;
+		size_t i;
+		if (!(cols & COL_BIT(c))) {
+			continue;
+		}
+		store_colpath(p, (enum eve_col)c, path);
+		if ((s->fds[c] = open(path, O_RDONLY)) == -1) {
+			printf("Failed to open %s with error: %s\n",
+			    path, strerror(errno));
+			goto fail;
+		}
+		ext = arena_alloc(a, sizeof(*ext) * (s->ngroups + 1));
+		s->bufs[c] = arena_alloc(a, SCAN_GROUP * size);
+		if (ext == NULL || s->bufs[c] == NULL) {
+			goto fail;
+		}
+		for (i = 0; i < s->ngroups; ++i) {
+			const uint64_t first = s->groups[i] * SCAN_GROUP;
+			const uint64_t n = (p->rows - first < SCAN_GROUP)
+			    ? p->rows - first : SCAN_GROUP;
+			ext[i].off = (off_t)(first * size);
+			ext[i].len = (size_t)(n * size);
+		}
+		ra_init(&s->ra[c], s->fds[c], ext, s->ngroups, depth);
+	}
+	return 0;
+
+fail:
+	scan_close(s);
+	return 1;
+}
+
+int
+scan_next(struct scan *s, struct scan_batch *b)
+{
+	ssize_t rb;
+	int c;
+	if (s->next == s->ngroups) {
+		return 1;
+	}
+	b->first = s->groups[s->next++] * SCAN_GROUP;
+	b->n = 0;
+	for (c = 0; c < NALLCOLS; ++c) {
+		if (!(s->cols & COL_BIT(c))) {
+			b->col[c] = NULL;
+			continue;
+		}
+		if ((rb = ra_next(&s->ra[c], s->bufs[c])) <= 0) {
+			printf("Short column %s in %s\n", eve_col_names[c],
+			    s->part->dir);
+			return -1;
+		}
+		if (s->verify && c < NCOLS && checksum_group(&s->sums,
+		    (enum eve_col)c, b->first / SCAN_GROUP, s->bufs[c],
+		    (size_t)rb)) {
+			printf("Checksum mismatch: %s%s, row group %llu\n",
+			    s->part->dir, eve_col_names[c],
+			    (unsigned long long)(b->first / SCAN_GROUP));
+			return -1;
+		}
+		b->n = (size_t)rb / eve_col_sizes[c];
+		b->col[c] = s->bufs[c];
+	}
+	return 0;
+}
+
+void
+scan_close(struct scan *s)
+{
+	int c;
+	for (c = 0; c < NALLCOLS; ++c) {
+		if (s->fds[c] != -1) {
+			close(s->fds[c]);
+			s->fds[c] = -1;
+		}
+	}
+	return;
+}
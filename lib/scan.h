@@ -0,0 +1,61 @@
+#ifndef SCAN_H_
+#define SCAN_H_
+
+#include <stddef.h>	/* size_t */
+#include <stdint.h>	/* uint*_t */
+
+#include "arena.h"	/* struct arena */
+#include "checksum.h"	/* struct checksums */
+#include "eve_txn.h"	/* enum eve_col */
+#include "readahead.h"	/* struct readahead */
+#include "store.h"	/* struct partition */
+
+/*
+ * Column scan over one partition, a row group (SCAN_GROUP rows) at a time.
+ * The caller says which columns it needs and which row groups its plan
+ * kept; every column then gets its own read-ahead schedule over exactly
+ * those groups. Buffers come from the query's arena. With EVE_VERIFY=1,
+ * each group is checked against the partition's checksums as it's read.
+*/
+
+#define SCAN_GROUP 4096
+
+struct scan_batch {
+	uint64_t first;		/* Partition row number of row 0. */
+	size_t n;
+	void *col[NALLCOLS];	/* Only the requested columns are set. */
+};
+
+struct scan {
+	const struct partition *part;
+	unsigned int cols;	/* COL_BIT() mask. */
+	int fds[NALLCOLS];
+	struct readahead ra[NALLCOLS];
+	uint64_t *groups;	/* Selected row groups, ascending. */
+	size_t ngroups;
+	size_t next;
+	void *bufs[NALLCOLS];
+	int verify;		/* Against sums, see checksum.h */
+	struct checksums sums;
+};
+
+/* Number of row groups in p. */
+uint64_t
+scan_ngroups(const struct partition *p);
+
+/*
+ * keep has scan_ngroups(p) bytes, nonzero for groups to read; NULL reads
+ * them all. depth is passed to ra_init(). Returns 0 on success.
+*/
+int
+scan_open(struct scan *s, const struct partition *p, unsigned int cols,
+    const uint8_t *keep, unsigned int depth, struct arena *a);
+
+/* Returns 0 with a batch, 1 at the end, -1 on errors. */
+int
+scan_next(struct scan *s, struct scan_batch *b);
+
+void
+scan_close(struct scan *s);
+
+#endif
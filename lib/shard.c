@@ -0,0 +1,56 @@
+#include "shard.h"
+
+#include <string.h>	/* memcpy() */
+#include <assert.h>	/* assert() */
+
+void
+shard_ids(const uint32_t *typeID, size_t n, unsigned int nshards,
+    uint8_t *ids)
+{
+	size_t i;
+	{ /* Preconditions */
+		assert(nshards > 0 && nshards <= SHARD_MAX);
+		assert(typeID != NULL || n == 0);
+	}
+	for (i = 0; i < n; ++i) {
+		ids[i] = (uint8_t)shard_of(typeID[i], nshards);
+	}
+	return;
+}
+
+void
+shard_offsets(const uint8_t *ids, size_t n, unsigned int nshards,
+    size_t *offsets)
+{
+	size_t i, counts[SHARD_MAX] = { 0 };
+	unsigned int s;
+	for (i = 0; i < n; ++i) {
+		counts[ids[i]]++;
+	}
+	offsets[0] = 0;
+	for (s = 0; s < nshards; ++s) {
+		offsets[s + 1] = offsets[s] + counts[s];
+	}
+	return;
+}
+
+void
+shard_scatter(const struct eve_txn *in, size_t n, unsigned int nshards,
+    struct eve_txn *out, size_t *offsets, uint8_t *ids)
+{
+	size_t i, at[SHARD_MAX];
+	{ /* Preconditions */
+		assert(nshards > 0 && nshards <= SHARD_MAX);
+		assert(in != NULL || n == 0);
+	}
+	/* Kept apart from the counting so it vectorizes. */
+	for (i = 0; i < n; ++i) {
+		ids[i] = (uint8_t)shard_of(in[i].typeID, nshards);
+	}
+	shard_offsets(ids, n, nshards, offsets);
+	memcpy(at, offsets, sizeof(*at) * nshards);
+	for (i = 0; i < n; ++i) {
+		out[at[ids[i]]++] = in[i];
+	}
+	return;
+}
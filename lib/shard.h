@@ -0,0 +1,53 @@
+#ifndef SHARD_H_
+#define SHARD_H_
+
+#include <stddef.h>	/* size_t */
+#include <stdint.h>	/* uint*_t */
+
+#include "eve_txn.h"	/* struct eve_txn */
+
+/*
+ * Shared-nothing partitioning of txns by typeID.
+ *
+ * Every stateful operator we have in mind (order books, dedup, rollups)
+ * keys on typeID plus something else, so hashing typeID to a shard lets
+ * each shard own its state outright. Batches are split with a radix
+ * scatter: one pass computes shard ids, one counts, one places rows.
+ * The converter scatters txns over its column writers, and market.c the
+ * orders of a book over pool workers, merging their sorted shards back
+ * in key order.
+*/
+
+#define SHARD_MAX 256
+
+/* Fibonacci hashing; spreads the clustered type IDs evenly. */
+static inline unsigned int
+shard_of(uint32_t typeID, unsigned int nshards)
+{
+	return (unsigned int)(((uint64_t)(typeID * 2654435769u) * nshards)
+	    >> 32);
+}
+
+/* Shard ids of n type IDs into ids; a pass on its own, so it vectorizes. */
+void
+shard_ids(const uint32_t *typeID, size_t n, unsigned int nshards,
+    uint8_t *ids);
+
+/*
+ * Counts the n shard ids into offsets, nshards + 1 of them: rows of shard
+ * s go from offsets[s] up to offsets[s + 1].
+*/
+void
+shard_offsets(const uint8_t *ids, size_t n, unsigned int nshards,
+    size_t *offsets);
+
+/*
+ * Stable scatter of n txns into out, grouped by shard. On return rows of
+ * shard s are out[offsets[s]] to out[offsets[s + 1] - 1]; offsets needs
+ * nshards + 1 entries. ids is n bytes of scratch.
+*/
+void
+shard_scatter(const struct eve_txn *in, size_t n, unsigned int nshards,
+    struct eve_txn *out, size_t *offsets, uint8_t *ids);
+
+#endif
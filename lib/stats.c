@@ -0,0 +1,230 @@
+#include "stats.h"
+
+#include <stdio.h>	/* fopen(), printf() */
+#include <string.h>	/* memcmp() */
+#include <assert.h>	/* assert() */
+
+#include "scan.h"
+
+#define STATS_MAGIC "EVESTS1"
+
+const enum eve_col stats_cols[NSTATS] = {
+	COL_TYPEID, COL_REGIONID, COL_PRICE, COL_RTIME
+};
+
+#define STATS_COLS (COL_BIT(COL_TYPEID) | COL_BIT(COL_REGIONID) \
+	| COL_BIT(COL_PRICE) | COL_BIT(COL_RTIME))
+
+/* Row i of a stats column, widened. */
+static uint64_t
+value(const struct scan_batch *b, enum stats_col c, size_t i)
+{
+	const enum eve_col col = stats_cols[c];
+	if (eve_col_sizes[col] == sizeof(uint64_t)) {
+		return ((const uint64_t *)b->col[col])[i];
+	}
+	return ((const uint32_t *)b->col[col])[i];
+}
+
+int
+stats_build(struct stats *st, const struct partition *p, struct arena *a)
+{
+	struct scan scan;
+	struct scan_batch b;
+	struct zone *z;
+	size_t i;
+	int c, rc;
+	{ /* Preconditions */
+		assert(st != NULL);
+		assert(p != NULL);
+		assert(a != NULL);
+	}
+	st->rows = p->rows;
+	st->ngroups = scan_ngroups(p);
+	st->zones = arena_alloc(a, sizeof(*st->zones) * (st->ngroups + 1));
+	if (st->zones == NULL) {
+		return 1;
+	}
+	for (c = 0; c < NSTATS; ++c) {
+		st->col[c].min = p->rows ? UINT64_MAX : 0;
+		st->col[c].max = 0;
+		memset(st->col[c].hist, 0, sizeof(st->col[c].hist));
+		hll_init(&st->col[c].ndv);
+	}
+	/* Pass one: bounds, zones and distinct counts. */
+	if (scan_open(&scan, p, STATS_COLS, NULL, 0, a)) {
+		return 1;
+	}
+	while ((rc = scan_next(&scan, &b)) == 0) {
+		z = &st->zones[b.first / SCAN_GROUP];
+		for (c = 0; c < NSTATS; ++c) {
+			struct colstats *cs = &st->col[c];
+			z->min[c] = UINT64_MAX;
+			z->max[c] = 0;
+			for (i = 0; i < b.n; ++i) {
+				const uint64_t v = value(&b, c, i);
+				z->min[c] = v < z->min[c] ? v : z->min[c];
+				z->max[c] = v > z->max[c] ? v : z->max[c];
+				hll_add(&cs->ndv, v);
+			}
+			cs->min = z->min[c] < cs->min ? z->min[c] : cs->min;
+			cs->max = z->max[c] > cs->max ? z->max[c] : cs->max;
+		}
+	}
+	scan_close(&scan);
+	if (rc < 0) {
+		return 1;
+	}
+	/* Pass two: histograms, now that the bounds are known. */
+	for (c = 0; c < NSTATS; ++c) {
+		st->col[c].width = (st->col[c].max - st->col[c].min)
+		    / STATS_BUCKETS + 1;
+	}
+	if (scan_open(&scan, p, STATS_COLS, NULL, 0, a)) {
+		return 1;
+	}
+	while ((rc = scan_next(&scan, &b)) == 0) {
+		for (c = 0; c < NSTATS; ++c) {
+			struct colstats *cs = &st->col[c];
+			for (i = 0; i < b.n; ++i) {
+				cs->hist[(value(&b, c, i) - cs->min)
+				    / cs->width]++;
+			}
+		}
+	}
+	scan_close(&scan);
+	return rc < 0;
+}
+
+int
+stats_save(const struct stats *st, const struct partition *p)
+{
+	char path[STORE_PATHLEN], tmp[STORE_PATHLEN];
+	FILE *f;
+	int rc = 0;
+	store_path(p, STATS_FILE, path);
+	store_path(p, STATS_FILE ".tmp", tmp);
+	if (!(f = fopen(tmp, "wb"))) {
+		printf("Failed to open %s\n", tmp);
+		return 1;
+	}
+	/* Queries may be reading the old stats; swap them in whole. */
+	if (fwrite(STATS_MAGIC, sizeof(STATS_MAGIC), 1, f) != 1
+	    || fwrite(&st->rows, sizeof(st->rows), 1, f) != 1
+	    || fwrite(&st->ngroups, sizeof(st->ngroups), 1, f) != 1
+	    || fwrite(st->col, sizeof(st->col), 1, f) != 1
+	    || fwrite(st->zones, sizeof(*st->zones), st->ngroups, f)
+	    != st->ngroups) {
+		rc = 1;
+	}
+	if (fclose(f) || rc || rename(tmp, path)) {
+		printf("Failed to write %s\n", path);
+		remove(tmp);
+		return 1;
+	}
+	return 0;
+}
+
+int
+stats_load(struct stats *st, const struct partition *p, struct arena *a)
+{
+	char path[STORE_PATHLEN], magic[sizeof(STATS_MAGIC)];
+	FILE *f;
+	int rc = 1;
+	{ /* Preconditions */
+		assert(st != NULL);
+		assert(p != NULL);
+		assert(a != NULL);
+	}
+	store_path(p, STATS_FILE, path);
+	if (!(f = fopen(path, "rb"))) {
+		return 1;
+	}
+	if (fread(magic, sizeof(magic), 1, f) != 1
+	    || memcmp(magic, STATS_MAGIC, sizeof(magic))
+	    || fread(&st->rows, sizeof(st->rows), 1, f) != 1
+	    || fread(&st->ngroups, sizeof(st->ngroups), 1, f) != 1
+	    || st->rows != p->rows || st->ngroups != scan_ngroups(p)
+	    || fread(st->col, sizeof(st->col), 1, f) != 1) {
+		goto out;
+	}
+	st->zones = arena_alloc(a, sizeof(*st->zones) * (st->ngroups + 1));
+	if (st->zones != NULL && fread(st->zones, sizeof(*st->zones),
+	    st->ngroups, f) == st->ngroups) {
+		rc = 0;
+	}
+out:
+	fclose(f);
+	return rc;
+}
+
+int
+stats_collect(const char *dir)
+{
+	struct partition p;
+	struct stats st;
+	struct arena a;
+	int rc;
+	if (partition_init(&p, dir, "")) {
+		printf("No columns in %s\n", dir);
+		return 1;
+	}
+	/* Two scans' buffers and extents, and the zones. */
+	if (arena_init(&a, (1UL << 20) + scan_ngroups(&p) * 256,
+	    MEM_INDEX)) {
+		return 1;
+	}
+	rc = stats_build(&st, &p, &a) || stats_save(&st, &p);
+	arena_free(&a);
+	return rc;
+}
+
+double
+stats_eq(const struct stats *st, enum stats_col c, uint64_t v)
+{
+	const struct colstats *cs = &st->col[c];
+	double perbucket;
+	unsigned int b, nonempty = 0;
+	if (st->rows == 0 || v < cs->min || v > cs->max) {
+		return 0;
+	}
+	b = (unsigned int)((v - cs->min) / cs->width);
+	if (cs->hist[b] == 0) {
+		return 0;
+	}
+	for (b = 0; b < STATS_BUCKETS; ++b) {
+		nonempty += cs->hist[b] != 0;
+	}
+	/* Spread each bucket's rows evenly over its share of the values. */
+	perbucket = hll_count(&cs->ndv) / nonempty;
+	if (perbucket > (double)cs->width) {
+		perbucket = (double)cs->width;
+	} else if (perbucket < 1) {
+		perbucket = 1;
+	}
+	return (double)cs->hist[(v - cs->min) / cs->width] / perbucket;
+}
+
+double
+stats_range(const struct stats *st, enum stats_col c, uint64_t lo,
+    uint64_t hi)
+{
+	const struct colstats *cs = &st->col[c];
+	double est = 0;
+	unsigned int b;
+	if (st->rows == 0 || lo > cs->max || hi <= cs->min || lo >= hi) {
+		return 0;
+	}
+	for (b = 0; b < STATS_BUCKETS; ++b) {
+		/* Bucket b holds [start, start + width), linearly. */
+		const uint64_t start = cs->min + b * cs->width;
+		const uint64_t end = start + cs->width;
+		const uint64_t from = lo > start ? lo : start;
+		const uint64_t to = hi < end ? hi : end;
+		if (from < to) {
+			est += (double)cs->hist[b] * (double)(to - from)
+			    / (double)cs->width;
+		}
+	}
+	return est;
+}
@@ -0,0 +1,81 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdint.h>	/* uint*_t */
+
+#include "arena.h"	/* struct arena */
+#include "eve_txn.h"	/* enum eve_col */
+#include "hll.h"	/* struct hll */
+#include "store.h"	/* struct partition */
+
+/*
+ * Per-partition statistics, collected when the converter writes a
+ * partition and saved next to its columns in STATS_FILE. For each of the
+ * columns queries filter on there's a min/max, a distinct-count sketch and
+ * an equi-width histogram, plus a zone map: the min/max of every row group
+ * (SCAN_GROUP rows). The planner (see plan.h) estimates row counts from
+ * the former and skips row groups with the latter.
+*/
+
+#define STATS_FILE "STATS"
+#define STATS_BUCKETS 64
+
+enum stats_col {
+	STAT_TYPEID = 0,
+	STAT_REGIONID,
+	STAT_PRICE,
+	STAT_RTIME,
+	NSTATS
+};
+
+extern const enum eve_col stats_cols[NSTATS];	/* Column of each stat. */
+
+struct colstats {
+	uint64_t min;
+	uint64_t max;
+	uint64_t width;			/* Of a histogram bucket. */
+	uint64_t hist[STATS_BUCKETS];	/* Rows per bucket from min. */
+	struct hll ndv;
+};
+
+struct zone {
+	uint64_t min[NSTATS];
+	uint64_t max[NSTATS];
+};
+
+struct stats {
+	uint64_t rows;
+	uint64_t ngroups;
+	struct colstats col[NSTATS];
+	struct zone *zones;		/* ngroups of them. */
+};
+
+/* Scans p into st; zones come from a. Returns 0 on success. */
+int
+stats_build(struct stats *st, const struct partition *p, struct arena *a);
+
+/* Returns 0 on success. */
+int
+stats_save(const struct stats *st, const struct partition *p);
+
+/*
+ * Returns 0 on success, 1 if p has no stats or they don't match its
+ * columns (the partition was rewritten since).
+*/
+int
+stats_load(struct stats *st, const struct partition *p, struct arena *a);
+
+/* Builds and saves the stats of the partition in dir. Returns 0 on success. */
+int
+stats_collect(const char *dir);
+
+/* Estimated rows with column c equal to v; 0 means none for certain. */
+double
+stats_eq(const struct stats *st, enum stats_col c, uint64_t v);
+
+/* Estimated rows with column c in [lo, hi). */
+double
+stats_range(const struct stats *st, enum stats_col c, uint64_t lo,
+    uint64_t hi);
+
+#endif
@@ -0,0 +1,122 @@
+#include "store.h"
+
+#include <stdio.h>	/* fopen(), snprintf() */
+#include <stdlib.h>	/* realloc() */
+#include <string.h>	/* strlen() */
+#include <sys/stat.h>	/* stat() */
+#include <assert.h>	/* assert() */
+
+int
+partition_init(struct partition *p, const char *dir, const char *date)
+{
+	struct stat st;
+	char path[STORE_PATHLEN];
+	{ /* Preconditions */
+		assert(p != NULL);
+		assert(dir != NULL);
+	}
+	snprintf(path, sizeof(path), "%s%s", dir, eve_col_names[COL_ORDERID]);
+	if (stat(path, &st)) {
+		return 1;
+	}
+	snprintf(p->dir, sizeof(p->dir), "%s", dir);
+	snprintf(p->date, sizeof(p->date), "%s", date);
+	p->rows = (uint64_t)st.st_size / eve_col_sizes[COL_ORDERID];
+	p->shard = 0;
+	p->nshards = 1;
+	return 0;
+}
+
+/* Adds dir as a partition if it holds columns. Returns 1 if it did. */
+static int
+add_partition(struct store *s, const char *dir, const char *date)
+{
+	struct partition part, *p;
+	if (partition_init(&part, dir, date)) {
+		return 0;
+	}
+	p = realloc(s->parts, sizeof(*p) * (s->nparts + 1));
+	if (p == NULL) {
+		return -1;
+	}
+	s->parts = p;
+	s->parts[s->nparts++] = part;
+	return 1;
+}
+
+int
+store_open(struct store *s, const char *root)
+{
+	FILE *f;
+	char line[64], dir[STORE_PATHLEN];
+	unsigned int shard, i;
+	int rc;
+	{ /* Preconditions */
+		assert(s != NULL);
+		assert(root != NULL);
+	}
+	s->nparts = 0;
+	s->parts = NULL;
+	snprintf(s->root, sizeof(s->root), "%s", root);
+	snprintf(dir, sizeof(dir), "%s/MANIFEST", root);
+	if (!(f = fopen(dir, "r"))) {
+		printf("Failed to open %s\n", dir);
+		return 1;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\n")] = '\0';
+		if (line[0] == '\0') {
+			continue;
+		}
+		snprintf(dir, sizeof(dir), "%s/%s/", root, line);
+		if ((rc = add_partition(s, dir, line)) != 0) {
+			if (rc < 0) {
+				goto fail;
+			}
+			continue;
+		}
+		for (shard = 0;; ++shard) { /* A sharded segment. */
+			snprintf(dir, sizeof(dir), "%s/%s/shard%u/", root, line,
+			    shard);
+			if ((rc = add_partition(s, dir, line)) < 0) {
+				goto fail;
+			} else if (rc == 0) {
+				break;
+			}
+			s->parts[s->nparts - 1].shard = shard;
+		}
+		for (i = s->nparts - shard; i < s->nparts; ++i) {
+			s->parts[i].nshards = shard;
+		}
+	}
+	fclose(f);
+	return 0;
+
+fail:
+	fclose(f);
+	store_free(s);
+	return 1;
+}
+
+void
+store_free(struct store *s)
+{
+	free(s->parts);
+	s->parts = NULL;
+	s->nparts = 0;
+	return;
+}
+
+void
+store_path(const struct partition *p, const char *name, char *buf)
+{
+	snprintf(buf, STORE_PATHLEN, "%s%s", p->dir, name);
+	return;
+}
+
+void
+store_colpath(const struct partition *p, enum eve_col col, char *buf)
+{
+	store_path(p, eve_col_names[col], buf);
+	return;
+}
@@ -0,0 +1,55 @@
+#ifndef STORE_H_
+#define STORE_H_
+
+#include <stdint.h>	/* uint*_t */
+
+#include "eve_txn.h"	/* enum eve_col */
+
+/*
+ * A store is what dumper.sh builds: a directory of immutable segments,
+ * one per dump date, listed in MANIFEST in publication order. A segment
+ * holds one file per column, or shardN/ subdirectories of them when the
+ * converter ran with EVE_SHARDS. Either way each directory of column files
+ * is a partition, the unit queries scan and prune. A shard only holds the
+ * typeIDs shard_of() gives it, so per item queries read one per segment.
+*/
+
+#define STORE_PATHLEN 512
+
+struct partition {
+	char dir[STORE_PATHLEN];	/* With a trailing '/'. */
+	char date[11];			/* YYYY-MM-DD of the segment. */
+	uint64_t rows;
+	unsigned int shard;		/* Its typeID bucket, see shard.h */
+	unsigned int nshards;		/* Buckets in the segment, or 1. */
+};
+
+struct store {
+	char root[STORE_PATHLEN];
+	unsigned int nparts;
+	struct partition *parts;
+};
+
+/*
+ * Fills in p for the column files in dir, which has a trailing '/'.
+ * Returns 0 on success, 1 if dir holds no columns.
+*/
+int
+partition_init(struct partition *p, const char *dir, const char *date);
+
+/* Reads root/MANIFEST. Returns 0 on success, 1 on failure. */
+int
+store_open(struct store *s, const char *root);
+
+void
+store_free(struct store *s);
+
+/* Path of file name in partition p, in buf of STORE_PATHLEN bytes. */
+void
+store_path(const struct partition *p, const char *name, char *buf);
+
+/* Path of column col in partition p, in buf of STORE_PATHLEN bytes. */
+void
+store_colpath(const struct partition *p, enum eve_col col, char *buf);
+
+#endif
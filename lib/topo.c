@@ -0,0 +1,141 @@
+#define _GNU_SOURCE	/* cpu_set_t, sched_setaffinity() */
+#include "topo.h"
+
+#include <stdio.h>	/* printf(), fopen() */
+#include <stdlib.h>	/* strtol() */
+#include <string.h>	/* strncmp() */
+#include <ctype.h>	/* isdigit() */
+#include <unistd.h>	/* sysconf() */
+#include <assert.h>	/* assert() */
+
+#define NODEDIR "/sys/devices/system/node/"
+
+/* Parses a sysfs style CPU list ("0-3,8,10-11") into set. */
+static int
+parse_cpulist(const char* str, cpu_set_t *set)
+{
+	char *end;
+	long lo, hi;
+	CPU_ZERO(set);
+	while (*str != '\0' && *str != '\n') {
+		lo = hi = strtol(str, &end, 10);
+		if (end == str || lo < 0) {
+			return 1;
+		}
+		str = end;
+		if (*str == '-') {
+			hi = strtol(str + 1, &end, 10);
+			if (end == str + 1 || hi < lo) {
+				return 1;
+			}
+			str = end;
+		}
+		for (; lo <= hi && lo < CPU_SETSIZE; ++lo) {
+			CPU_SET((int)lo, set);
+		}
+		if (*str == ',') {
+			str++;
+		}
+	}
+	return CPU_COUNT(set) == 0;
+}
+
+int
+topo_init(struct topo *t)
+{
+	char path[64], buf[1024];
+	FILE *f;
+	int node;
+	{ /* Preconditions */
+		assert(t != NULL);
+	}
+	t->nodes = 0;
+	for (node = 0; node < TOPO_MAXNODES; ++node) {
+		snprintf(path, sizeof(path), NODEDIR "node%d/cpulist", node);
+		if (!(f = fopen(path, "r"))) {
+			break;
+		}
+		if (!fgets(buf, sizeof(buf), f)) {
+			buf[0] = '\0';
+		}
+		fclose(f);
+		/* Memory-only nodes have no CPUs, keep an empty set. */
+		if (parse_cpulist(buf, &t->cpus[node])) {
+			CPU_ZERO(&t->cpus[node]);
+		}
+		t->nodes = node + 1;
+	}
+	if (t->nodes == 0) { /* No sysfs node info, assume a single node. */
+		long cpu, ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		CPU_ZERO(&t->cpus[0]);
+		for (cpu = 0; cpu < ncpu && cpu < CPU_SETSIZE; ++cpu) {
+			CPU_SET((int)cpu, &t->cpus[0]);
+		}
+		t->nodes = 1;
+	}
+	return 0;
+}
+
+int
+topo_pin(const struct topo *t, const char *spec)
+{
+	cpu_set_t set;
+	{ /* Preconditions */
+		assert(t != NULL);
+	}
+	if (spec == NULL || *spec == '\0') {
+		return 0;
+	}
+	if (strncmp(spec, "node:", 5) == 0) {
+		const int node = atoi(spec + 5);
+		if (!isdigit(spec[5]) || node >= t->nodes
+		    || CPU_COUNT(&t->cpus[node]) == 0) {
+			printf("Bad pin spec: %s\n", spec);
+			return 1;
+		}
+		set = t->cpus[node];
+	} else if (parse_cpulist(spec, &set)) {
+		printf("Bad pin spec: %s\n", spec);
+		return 1;
+	}
+	if (sched_setaffinity(0, sizeof(set), &set)) {
+		perror("sched_setaffinity()");
+		return 1;
+	}
+	return 0;
+}
+
+void
+topo_report(const struct topo *t, const char *stage)
+{
+	/* numa_maps lists "N<node>=<pages>" for every mapping. */
+	unsigned long pages[TOPO_MAXNODES] = { 0 };
+	char buf[4096];
+	FILE *f;
+	int node;
+	{ /* Preconditions */
+		assert(t != NULL);
+		assert(stage != NULL);
+	}
+	if ((f = fopen("/proc/self/numa_maps", "r"))) {
+		while (fgets(buf, sizeof(buf), f)) {
+			const char *s = buf;
+			while ((s = strstr(s, " N"))) {
+				char *end;
+				s += 2;
+				node = (int)strtol(s, &end, 10);
+				if (end != s && *end == '=' && node >= 0
+				    && node < TOPO_MAXNODES) {
+					pages[node] +=
+					    strtoul(end + 1, NULL, 10);
+				}
+			}
+		}
+		fclose(f);
+	}
+	printf("%s: cpu %d", stage, sched_getcpu());
+	for (node = 0; node < t->nodes; ++node) {
+		printf(" node%d %lu pages", node, pages[node]);
+	}
+	printf("\n");
+}
@@ -0,0 +1,38 @@
+#ifndef TOPO_H_
+#define TOPO_H_
+
+#include <sched.h>	/* cpu_set_t, needs _GNU_SOURCE before any include */
+
+/*
+ * NUMA topology detection and pinning of pipeline stages.
+ *
+ * Each stage (parser, column writer, ...) pins itself with topo_pin()
+ * before it allocates or touches its buffers. Linux places anonymous pages
+ * on the node of the CPU that first touches them, so a pinned stage gets
+ * node-local buffers without any explicit NUMA allocation calls.
+*/
+
+#define TOPO_MAXNODES 64
+
+struct topo {
+	int nodes;			/* Number of nodes, at least 1. */
+	cpu_set_t cpus[TOPO_MAXNODES];	/* CPUs belonging to each node. */
+};
+
+/* Reads the topology from sysfs. Falls back to one node with every CPU. */
+int
+topo_init(struct topo *t);
+
+/*
+ * Pins the calling process/thread. spec is either "node:N" or a CPU list
+ * such as "0-3,8". NULL or "" leaves the affinity alone. Returns 0 on
+ * success, 1 on a bad spec or failed sched_setaffinity().
+*/
+int
+topo_pin(const struct topo *t, const char *spec);
+
+/* Prints resident pages per node for this process, tagged with stage. */
+void
+topo_report(const struct topo *t, const char *stage);
+
+#endif
@@ -0,0 +1,86 @@
+#include "tz.h"
+
+#include <string.h>	/* strcmp() */
+#include <assert.h>	/* assert() */
+
+const struct tz_zone *
+tz_find(const char *name)
+{
+	unsigned int i;
+	{ /* Preconditions */
+		assert(name != NULL);
+	}
+	for (i = 0; i < tz_nzones; ++i) {
+		if (strcmp(tz_zones[i].name, name) == 0) {
+			return &tz_zones[i];
+		}
+	}
+	return NULL;
+}
+
+/* Returns the last i with at[i] <= t. */
+static uint32_t
+find(const struct tz_zone *z, uint32_t t)
+{
+	uint32_t lo = 0, hi = z->n;
+	while (hi - lo > 1) {
+		const uint32_t mid = lo + (hi - lo) / 2;
+		if (z->at[mid] <= t) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+uint32_t
+tz_to_utc(const struct tz_zone *z, uint32_t t)
+{
+	{ /* Preconditions */
+		assert(z != NULL);
+		assert(z->n > 0 && z->at[0] == 0);
+	}
+	if (t >= z->end) {
+		return TZ_NONE;
+	}
+	return t + (uint32_t)z->off[find(z, t)];
+}
+
+void
+tz_to_utc_batch(const struct tz_zone *z, uint32_t *t, size_t n)
+{
+	int32_t add[TZ_BLOCK];
+	size_t i, j, m;
+	uint32_t k;
+	{ /* Preconditions */
+		assert(z != NULL);
+		assert(z->n > 0 && z->at[0] == 0);
+		assert(t != NULL || n == 0);
+	}
+	for (i = 0; i < n; i += m) {
+		uint32_t *const b = t + i;
+		uint32_t lo = UINT32_MAX, hi = 0;
+		m = (n - i < TZ_BLOCK) ? n - i : TZ_BLOCK;
+		for (j = 0; j < m; ++j) {
+			lo = (b[j] < lo) ? b[j] : lo;
+			hi = (b[j] > hi) ? b[j] : hi;
+		}
+		k = find(z, lo);
+		for (j = 0; j < m; ++j) {
+			add[j] = z->off[k];
+		}
+		/* Each transition in the block moves the times after it. */
+		for (++k; k < z->n && z->at[k] <= hi; ++k) {
+			const uint32_t at = z->at[k];
+			const int32_t d = z->off[k] - z->off[k - 1];
+			for (j = 0; j < m; ++j) {
+				add[j] += d & -(int32_t)(b[j] >= at);
+			}
+		}
+		for (j = 0; j < m; ++j) {
+			b[j] = (b[j] < z->end) ? b[j] + (uint32_t)add[j]
+			    : TZ_NONE;
+		}
+	}
+}
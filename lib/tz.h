@@ -0,0 +1,55 @@
+#ifndef TZ_H_
+#define TZ_H_
+
+#include <stddef.h>	/* size_t */
+#include <stdint.h>	/* uint*_t */
+
+/*
+ * Local time to UTC for the zones dumps have been written in, from a table
+ * generated by tzgen.sh (lib/tztab.c) rather than constants in the parser.
+ *
+ * Times are seconds in the parser's calendar (see ejday() in
+ * eve_parser.c), as parsed from a dump. Offset off[i] applies from local
+ * time at[i] until at[i + 1]; at[0] is 0. Local times repeated when the
+ * clocks go back take the later offset, and skipped ones the earlier.
+ * The table ends at local time end, the start of tzgen.sh's last year;
+ * later times convert to TZ_NONE, since any offset for them is a guess.
+*/
+
+/* Times converted per block by tz_to_utc_batch(). */
+#define TZ_BLOCK 256
+
+/* What times past a zone's table convert to. */
+#define TZ_NONE UINT32_MAX
+
+struct tz_zone {
+	const char *name;	/* As in tzdata, e.g. "America/Los_Angeles". */
+	uint32_t n;
+	uint32_t end;		/* Local times from here on are unknown. */
+	const uint32_t *at;	/* Ascending local times. */
+	const int32_t *off;	/* Seconds to add to get UTC. */
+};
+
+extern const struct tz_zone tz_zones[];
+extern const unsigned int tz_nzones;
+
+/* The year every zone's end is the start of; dumps must predate it. */
+extern const unsigned int tz_endyear;
+
+/* Returns the zone called name, or NULL if the table doesn't have it. */
+const struct tz_zone *
+tz_find(const char *name);
+
+/* Returns t in UTC, or TZ_NONE if it's past the table. */
+uint32_t
+tz_to_utc(const struct tz_zone *z, uint32_t t);
+
+/*
+ * Converts n times in place, as tz_to_utc() would each. Works a block at
+ * a time with one lookup per block and no branches per time, so the loops
+ * vectorize; a block only pays for the transitions that fall inside it.
+*/
+void
+tz_to_utc_batch(const struct tz_zone *z, uint32_t *t, size_t n);
+
+#endif
@@ -0,0 +1,170 @@
+/* Generated by tzgen.sh from tzdata 2025b, 2003 to 2037. */
+
+#include "tz.h"
+
+static const uint32_t america_los_angeles_at[] = {
+	0, 1049684400, 1067302800, 1081134000, 1099357200, 1112583600,
+	1130806800, 1144033200, 1162256400, 1173754800, 1194310800, 1205204400,
+	1225760400, 1236654000, 1257210000, 1268708400, 1289264400, 1300158000,
+	1320714000, 1331607600, 1352163600, 1363057200, 1383613200, 1394506800,
+	1415062800, 1425956400, 1446512400, 1458010800, 1478566800, 1489460400,
+	1510016400, 1520910000, 1541466000, 1552359600, 1572915600, 1583809200,
+	1604365200, 1615863600, 1636419600, 1647313200, 1667869200, 1678762800,
+	1699318800, 1710212400, 1730768400, 1741662000, 1762218000, 1773111600,
+	1793667600, 1805166000, 1825722000, 1836615600, 1857171600, 1868065200,
+	1888621200, 1899514800, 1920070800, 1930964400, 1951520400, 1963018800,
+	1983574800, 1994468400, 2015024400, 2025918000, 2046474000, 2057367600,
+	2077923600, 2088817200, 2109373200,
+};
+static const int32_t america_los_angeles_off[] = {
+	28800, 25200, 28800, 25200, 28800, 25200,
+	28800, 25200, 28800, 25200, 28800, 25200,
+	28800, 25200, 28800, 25200, 28800, 25200,
+	28800, 25200, 28800, 25200, 28800, 25200,
+	28800, 25200, 28800, 25200, 28800, 25200,
+	28800, 25200, 28800, 25200, 28800, 25200,
+	28800, 25200, 28800, 25200, 28800, 25200,
+	28800, 25200, 28800, 25200, 28800, 25200,
+	28800, 25200, 28800, 25200, 28800, 25200,
+	28800, 25200, 28800, 25200, 28800, 25200,
+	28800, 25200, 28800, 25200, 28800, 25200,
+	28800, 25200, 28800,
+};
+
+static const uint32_t america_new_york_at[] = {
+	0, 1049684400, 1067302800, 1081134000, 1099357200, 1112583600,
+	1130806800, 1144033200, 1162256400, 1173754800, 1194310800, 1205204400,
+	1225760400, 1236654000, 1257210000, 1268708400, 1289264400, 1300158000,
+	1320714000, 1331607600, 1352163600, 1363057200, 1383613200, 1394506800,
+	1415062800, 1425956400, 1446512400, 1458010800, 1478566800, 1489460400,
+	1510016400, 1520910000, 1541466000, 1552359600, 1572915600, 1583809200,
+	1604365200, 1615863600, 1636419600, 1647313200, 1667869200, 1678762800,
+	1699318800, 1710212400, 1730768400, 1741662000, 1762218000, 1773111600,
+	1793667600, 1805166000, 1825722000, 1836615600, 1857171600, 1868065200,
+	1888621200, 1899514800, 1920070800, 1930964400, 1951520400, 1963018800,
+	1983574800, 1994468400, 2015024400, 2025918000, 2046474000, 2057367600,
+	2077923600, 2088817200, 2109373200,
+};
+static const int32_t america_new_york_off[] = {
+	18000, 14400, 18000, 14400, 18000, 14400,
+	18000, 14400, 18000, 14400, 18000, 14400,
+	18000, 14400, 18000, 14400, 18000, 14400,
+	18000, 14400, 18000, 14400, 18000, 14400,
+	18000, 14400, 18000, 14400, 18000, 14400,
+	18000, 14400, 18000, 14400, 18000, 14400,
+	18000, 14400, 18000, 14400, 18000, 14400,
+	18000, 14400, 18000, 14400, 18000, 14400,
+	18000, 14400, 18000, 14400, 18000, 14400,
+	18000, 14400, 18000, 14400, 18000, 14400,
+	18000, 14400, 18000, 14400, 18000, 14400,
+	18000, 14400, 18000,
+};
+
+static const uint32_t atlantic_reykjavik_at[] = {
+	0,
+};
+static const int32_t atlantic_reykjavik_off[] = {
+	0,
+};
+
+static const uint32_t europe_london_at[] = {
+	0, 1049162400, 1067302800, 1080612000, 1099357200, 1112061600,
+	1130806800, 1143511200, 1162256400, 1174960800, 1193706000, 1207015200,
+	1225155600, 1238464800, 1256605200, 1269914400, 1288659600, 1301364000,
+	1320109200, 1332813600, 1351558800, 1364868000, 1383008400, 1396317600,
+	1414458000, 1427767200, 1445907600, 1459216800, 1477962000, 1490666400,
+	1509411600, 1522116000, 1540861200, 1554170400, 1572310800, 1585620000,
+	1603760400, 1617069600, 1635814800, 1648519200, 1667264400, 1679968800,
+	1698714000, 1712023200, 1730163600, 1743472800, 1761613200, 1774922400,
+	1793062800, 1806372000, 1825117200, 1837821600, 1856566800, 1869271200,
+	1888016400, 1901325600, 1919466000, 1932775200, 1950915600, 1964224800,
+	1982970000, 1995674400, 2014419600, 2027124000, 2045869200, 2058573600,
+	2077318800, 2090628000, 2108768400,
+};
+static const int32_t europe_london_off[] = {
+	0, -3600, 0, -3600, 0, -3600,
+	0, -3600, 0, -3600, 0, -3600,
+	0, -3600, 0, -3600, 0, -3600,
+	0, -3600, 0, -3600, 0, -3600,
+	0, -3600, 0, -3600, 0, -3600,
+	0, -3600, 0, -3600, 0, -3600,
+	0, -3600, 0, -3600, 0, -3600,
+	0, -3600, 0, -3600, 0, -3600,
+	0, -3600, 0, -3600, 0, -3600,
+	0, -3600, 0, -3600, 0, -3600,
+	0, -3600, 0, -3600, 0, -3600,
+	0, -3600, 0,
+};
+
+static const uint32_t europe_berlin_at[] = {
+	0, 1049166000, 1067306400, 1080615600, 1099360800, 1112065200,
+	1130810400, 1143514800, 1162260000, 1174964400, 1193709600, 1207018800,
+	1225159200, 1238468400, 1256608800, 1269918000, 1288663200, 1301367600,
+	1320112800, 1332817200, 1351562400, 1364871600, 1383012000, 1396321200,
+	1414461600, 1427770800, 1445911200, 1459220400, 1477965600, 1490670000,
+	1509415200, 1522119600, 1540864800, 1554174000, 1572314400, 1585623600,
+	1603764000, 1617073200, 1635818400, 1648522800, 1667268000, 1679972400,
+	1698717600, 1712026800, 1730167200, 1743476400, 1761616800, 1774926000,
+	1793066400, 1806375600, 1825120800, 1837825200, 1856570400, 1869274800,
+	1888020000, 1901329200, 1919469600, 1932778800, 1950919200, 1964228400,
+	1982973600, 1995678000, 2014423200, 2027127600, 2045872800, 2058577200,
+	2077322400, 2090631600, 2108772000,
+};
+static const int32_t europe_berlin_off[] = {
+	-3600, -7200, -3600, -7200, -3600, -7200,
+	-3600, -7200, -3600, -7200, -3600, -7200,
+	-3600, -7200, -3600, -7200, -3600, -7200,
+	-3600, -7200, -3600, -7200, -3600, -7200,
+	-3600, -7200, -3600, -7200, -3600, -7200,
+	-3600, -7200, -3600, -7200, -3600, -7200,
+	-3600, -7200, -3600, -7200, -3600, -7200,
+	-3600, -7200, -3600, -7200, -3600, -7200,
+	-3600, -7200, -3600, -7200, -3600, -7200,
+	-3600, -7200, -3600, -7200, -3600, -7200,
+	-3600, -7200, -3600, -7200, -3600, -7200,
+	-3600, -7200, -3600,
+};
+
+static const uint32_t europe_moscow_at[] = {
+	0, 1049166000, 1067306400, 1080615600, 1099360800, 1112065200,
+	1130810400, 1143514800, 1162260000, 1174964400, 1193709600, 1207018800,
+	1225159200, 1238468400, 1256608800, 1269918000, 1288663200, 1301367600,
+	1414458000,
+};
+static const int32_t europe_moscow_off[] = {
+	-10800, -14400, -10800, -14400, -10800, -14400,
+	-10800, -14400, -10800, -14400, -10800, -14400,
+	-10800, -14400, -10800, -14400, -10800, -14400,
+	-10800,
+};
+
+static const uint32_t asia_shanghai_at[] = {
+	0,
+};
+static const int32_t asia_shanghai_off[] = {
+	-28800,
+};
+
+static const uint32_t utc_at[] = {
+	0,
+};
+static const int32_t utc_off[] = {
+	0,
+};
+
+#define ZONE(zone, c) { zone, sizeof(c##_at) / sizeof(c##_at[0]), \
+	2114380800U, c##_at, c##_off }
+
+const struct tz_zone tz_zones[] = {
+	ZONE("America/Los_Angeles", america_los_angeles),
+	ZONE("America/New_York", america_new_york),
+	ZONE("Atlantic/Reykjavik", atlantic_reykjavik),
+	ZONE("Europe/London", europe_london),
+	ZONE("Europe/Berlin", europe_berlin),
+	ZONE("Europe/Moscow", europe_moscow),
+	ZONE("Asia/Shanghai", asia_shanghai),
+	ZONE("UTC", utc),
+};
+
+const unsigned int tz_nzones = sizeof(tz_zones) / sizeof(tz_zones[0]);
+const unsigned int tz_endyear = 2037;
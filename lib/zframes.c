@@ -0,0 +1,249 @@
+#include "zframes.h"
+
+#include <stdlib.h>	/* malloc(), realloc() */
+#include <string.h>	/* memcpy() */
+#include <unistd.h>	/* pread(), write() */
+#include <sys/stat.h>	/* fstat() */
+#include <assert.h>	/* assert() */
+#include <zstd.h>
+
+#include "mem.h"
+
+#define SKIPPABLE_MAGIC 0x184D2A5E
+#define SEEKABLE_MAGIC 0x8F92EAB1
+#define FOOTER_SIZE 9	/* Number_Of_Frames, Descriptor, Seekable_Magic */
+
+static void
+put_le32(unsigned char *p, uint32_t v)
+{
+	p[0] = (unsigned char)v;
+	p[1] = (unsigned char)(v >> 8);
+	p[2] = (unsigned char)(v >> 16);
+	p[3] = (unsigned char)(v >> 24);
+}
+
+static uint32_t
+get_le32(const unsigned char *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16
+	    | (uint32_t)p[3] << 24;
+}
+
+int
+zframes_writer_init(struct zframes_writer *w, FILE *out, int level)
+{
+	{ /* Preconditions */
+		assert(w != NULL);
+		assert(out != NULL);
+	}
+	w->out = out;
+	w->level = level;
+	w->count = w->cap = 0;
+	w->sizes = NULL;
+	return 0;
+}
+
+int
+zframes_write(struct zframes_writer *w, const char *src, size_t len)
+{
+	const size_t bound = ZSTD_compressBound(len);
+	size_t csize;
+	void *dst;
+	if (len == 0) {
+		return 0;
+	}
+	if (len > UINT32_MAX || bound > UINT32_MAX) {
+		return 1;
+	}
+	if (w->count == w->cap) {
+		const uint32_t cap = w->cap ? w->cap * 2 : 64;
+		uint32_t *sizes = realloc(w->sizes, sizeof(*sizes) * 2 * cap);
+		if (sizes == NULL) {
+			return 1;
+		}
+		w->sizes = sizes;
+		w->cap = cap;
+	}
+	if ((dst = malloc(bound)) == NULL) {
+		return 1;
+	}
+	csize = ZSTD_compress(dst, bound, src, len, w->level);
+	if (ZSTD_isError(csize) || fwrite(dst, csize, 1, w->out) != 1) {
+		free(dst);
+		return 1;
+	}
+	free(dst);
+	w->sizes[2 * w->count] = (uint32_t)csize;
+	w->sizes[2 * w->count + 1] = (uint32_t)len;
+	w->count++;
+	return 0;
+}
+
+int
+zframes_writer_finish(struct zframes_writer *w)
+{
+	unsigned char buf[8];
+	uint32_t i;
+	int rc = 0;
+	/* Skippable frame header; its size covers entries and footer. */
+	put_le32(buf, SKIPPABLE_MAGIC);
+	put_le32(buf + 4, w->count * 8 + FOOTER_SIZE);
+	rc |= fwrite(buf, 8, 1, w->out) != 1;
+	for (i = 0; i < w->count; ++i) {
+		put_le32(buf, w->sizes[2 * i]);
+		put_le32(buf + 4, w->sizes[2 * i + 1]);
+		rc |= fwrite(buf, 8, 1, w->out) != 1;
+	}
+	put_le32(buf, w->count);
+	buf[4] = 0; /* Descriptor: no per-frame checksums. */
+	rc |= fwrite(buf, 5, 1, w->out) != 1;
+	put_le32(buf, SEEKABLE_MAGIC);
+	rc |= fwrite(buf, 4, 1, w->out) != 1;
+	free(w->sizes);
+	w->sizes = NULL;
+	return rc;
+}
+
+int
+zframes_open(struct zframes *z, int fd)
+{
+	unsigned char footer[FOOTER_SIZE], *table;
+	struct stat st;
+	uint64_t in = 0;
+	off_t tablesize;
+	uint32_t i;
+	z->count = 0;
+	z->list = NULL;
+	if (fstat(fd, &st) || st.st_size < FOOTER_SIZE + 8
+	    || pread(fd, footer, FOOTER_SIZE, st.st_size - FOOTER_SIZE)
+	    != FOOTER_SIZE || get_le32(footer + 5) != SEEKABLE_MAGIC
+	    || (footer[4] & 0x7c) != 0) { /* Reserved bits must be zero. */
+		return 1;
+	}
+	{ /* Entries are 8 bytes, 12 with checksums. */
+		const off_t entry = (footer[4] & 0x80) ? 12 : 8;
+		z->count = get_le32(footer);
+		tablesize = (off_t)z->count * entry;
+		if (tablesize + FOOTER_SIZE + 8 > st.st_size) {
+			return 1;
+		}
+		table = malloc((size_t)tablesize + 1);
+		z->list = mem_alloc(sizeof(*z->list) * ((size_t)z->count + 1),
+		    MEM_INDEX);
+		if (table == NULL || z->list == NULL
+		    || pread(fd, table, (size_t)tablesize,
+		    st.st_size - FOOTER_SIZE - tablesize) != tablesize) {
+			free(table);
+			zframes_free(z);
+			return 1;
+		}
+		for (i = 0; i < z->count; ++i) {
+			z->list[i].in = in;
+			z->list[i].csize = get_le32(table + i * entry);
+			z->list[i].dsize = get_le32(table + i * entry + 4);
+			in += z->list[i].csize;
+		}
+	}
+	free(table);
+	/* The frames must exactly fill the space before the seek table. */
+	if (in + 8 + (uint64_t)tablesize + FOOTER_SIZE
+	    != (uint64_t)st.st_size) {
+		zframes_free(z);
+		return 1;
+	}
+	return 0;
+}
+
+void
+zframes_free(struct zframes *z)
+{
+	mem_free(z->list, sizeof(*z->list) * ((size_t)z->count + 1),
+	    MEM_INDEX);
+	z->list = NULL;
+	z->count = 0;
+	return;
+}
+
+struct job {
+	const struct zframe *f;
+	int fd;
+	char *buf;
+	int rc;
+	struct pool_group group;
+};
+
+static void
+decompress_frame(void *arg)
+{
+	struct job *j = arg;
+	char *src = mem_alloc(j->f->csize + 1, MEM_PARSER);
+	size_t got;
+	j->rc = 1;
+	if (src == NULL
+	    || (j->buf = mem_alloc(j->f->dsize + 1, MEM_PARSER)) == NULL) {
+		mem_free(src, j->f->csize + 1, MEM_PARSER);
+		return;
+	}
+	if (pread(j->fd, src, j->f->csize, (off_t)j->f->in)
+	    == (ssize_t)j->f->csize) {
+		got = ZSTD_decompress(j->buf, j->f->dsize, src, j->f->csize);
+		j->rc = ZSTD_isError(got) || got != j->f->dsize;
+	}
+	mem_free(src, j->f->csize + 1, MEM_PARSER);
+	return;
+}
+
+static int
+submit_frame(const struct zframes *z, int fd, struct pool *pool,
+    struct job *j, uint32_t frame)
+{
+	j->f = z->list + frame;
+	j->fd = fd;
+	j->buf = NULL;
+	j->rc = 1;
+	j->group.pending = 0;
+	return pool_submit(pool, POOL_LOW, decompress_frame, j, &j->group);
+}
+
+int
+zframes_cat(const struct zframes *z, int fd, int outfd, struct pool *pool)
+{
+	/* Frames in flight; enough to keep every worker busy. */
+	const uint32_t window = 2 * pool->nworkers;
+	struct job *j;
+	uint32_t i;
+	int rc = 0;
+	{ /* Preconditions */
+		assert(z != NULL);
+		assert(pool != NULL);
+	}
+	if ((j = calloc(window, sizeof(*j))) == NULL) {
+		return 1;
+	}
+	for (i = 0; i < window && i < z->count && !rc; ++i) {
+		rc = submit_frame(z, fd, pool, &j[i], i);
+	}
+	for (i = 0; i < z->count && !rc; ++i) { /* Write in order. */
+		struct job *cur = &j[i % window];
+		pool_wait(pool, &cur->group);
+		rc = cur->rc;
+		if (!rc && write(outfd, cur->buf, cur->f->dsize)
+		    != (ssize_t)cur->f->dsize) {
+			rc = 1;
+		}
+		mem_free(cur->buf, cur->f->dsize + 1, MEM_PARSER);
+		cur->buf = NULL;
+		if (!rc && i + window < z->count) {
+			rc = submit_frame(z, fd, pool, cur, i + window);
+		}
+	}
+	/* On failure, frames still in flight must finish before j goes. */
+	for (i = 0; i < window; ++i) {
+		pool_wait(pool, &j[i].group);
+		if (j[i].buf != NULL) {
+			mem_free(j[i].buf, j[i].f->dsize + 1, MEM_PARSER);
+		}
+	}
+	free(j);
+	return rc;
+}
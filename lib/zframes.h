@@ -0,0 +1,65 @@
+#ifndef ZFRAMES_H_
+#define ZFRAMES_H_
+
+#include <stdint.h>	/* uint*_t */
+#include <stdio.h>	/* FILE */
+#include <sys/types.h>	/* off_t */
+
+#include "pool.h"
+
+/*
+ * Seekable zstd archives of dumps.
+ *
+ * A repacked dump is a run of independent zstd frames, each ending on a
+ * line boundary, followed by the seek table from zstd's
+ * contrib/seekable_format (a skippable frame listing every frame's
+ * compressed and decompressed size). Any frame can be decompressed on its
+ * own, so a dump is inflated on as many cores as we like.
+*/
+
+struct zframe {
+	uint64_t in;	/* Offset of the frame in the file. */
+	uint32_t csize;
+	uint32_t dsize;
+};
+
+struct zframes {
+	uint32_t count;
+	struct zframe *list;
+};
+
+/* Streaming writer, used by repack. */
+struct zframes_writer {
+	FILE *out;
+	int level;
+	uint32_t count;
+	uint32_t cap;
+	uint32_t *sizes;	/* csize, dsize pairs for the seek table. */
+};
+
+int
+zframes_writer_init(struct zframes_writer *w, FILE *out, int level);
+
+/* Compresses src as one frame. Returns 0 on success, 1 on failure. */
+int
+zframes_write(struct zframes_writer *w, const char *src, size_t len);
+
+/* Appends the seek table and frees w. Returns 0 on success. */
+int
+zframes_writer_finish(struct zframes_writer *w);
+
+/* Reads the seek table of the archive on fd. Returns 0 on success. */
+int
+zframes_open(struct zframes *z, int fd);
+
+void
+zframes_free(struct zframes *z);
+
+/*
+ * Decompresses every frame to outfd in order, inflating frames ahead on
+ * pool as POOL_LOW work. Returns 0 on success, 1 on failure.
+*/
+int
+zframes_cat(const struct zframes *z, int fd, int outfd, struct pool *pool);
+
+#endif
@@ -0,0 +1,170 @@
+#include <stdio.h>	/* printf() */
+#include <stdlib.h>	/* malloc(), strtoul() */
+#include <stdint.h>	/* intptr_t */
+#include <signal.h>	/* signal() */
+#include <unistd.h>	/* getopt(), sleep(), close() */
+#include <pthread.h>	/* pthread_create() */
+#include <sys/stat.h>	/* stat() */
+#include <sys/socket.h>	/* accept() */
+
+#include "lib/arena.h"
+#include "lib/market.h"
+#include "lib/mem.h"
+#include "lib/net.h"
+#include "lib/pool.h"
+#include "lib/rcu.h"
+#include "lib/store.h"
+
+/*
+ * Usage: marketd [-i seconds] store addr
+ *
+ * Serves the current market of a store (see lib/market.h) on addr, as
+ * for shardd. Each connection sends struct market_query records and gets
+ * a struct market_reply for each; see book.c. Connections are threads
+ * sharing one book.
+ *
+ * The manifest is polled every -i seconds (default 10). When its newest
+ * segment is new, or was re-sent (a new directory), the next book is built
+ * on the side and published with rcu.h. Readers keep answering from the
+ * old book meanwhile, and never wait for the loader. Its orders are
+ * sharded by typeID over a thread pool, sized by EVE_THREADS.
+*/
+
+/* Scan buffers for building a book. */
+#define SCRATCH (4UL << 20)
+
+static struct rcu rcu;
+static struct pool pool;	/* Sorts the loader's books. */
+
+struct loader {
+	const char *root;
+	unsigned int interval;
+};
+
+/*
+ * Builds the book of s's newest segment if it isn't the one published,
+ * whose last partition directory is *ino. Returns 0 unless that fails.
+*/
+static int
+reload(const struct store *s, ino_t *ino, struct arena *a)
+{
+	const struct partition *last = &s->parts[s->nparts - 1];
+	const char *date = last->date;
+	struct market_book *book, *old;
+	struct stat st;
+	if (stat(last->dir, &st) || st.st_ino == *ino) {
+		return 0;
+	}
+	if ((book = malloc(sizeof(*book))) == NULL
+	    || market_build(book, s, date, a, &pool)) {
+		printf("Failed to build the book of %s\n", date);
+		free(book);
+		return 1;
+	}
+	if ((old = rcu_replace(&rcu, book)) != NULL) {
+		market_free(old);
+		free(old);
+	}
+	*ino = st.st_ino;
+	printf("Published %s: %llu orders in %u books\n", date,
+	    (unsigned long long)book->norders, book->nkeys);
+	mem_tag_report("marketd");
+	fflush(stdout);
+	return 0;
+}
+
+static void *
+load(void *arg)
+{
+	const struct loader *l = arg;
+	struct arena scratch;
+	struct store s;
+	ino_t ino = 0;
+	if (arena_init(&scratch, SCRATCH, MEM_SCAN)) {
+		return NULL;
+	}
+	for (;;) {
+		if (store_open(&s, l->root) == 0) {
+			if (s.nparts > 0) {
+				reload(&s, &ino, &scratch);
+			}
+			store_free(&s);
+		}
+		sleep(l->interval);
+	}
+	return NULL;
+}
+
+static void *
+serve(void *arg)
+{
+	const int fd = (int)(intptr_t)arg;
+	struct market_query q;
+	struct market_reply reply;
+	const int slot = rcu_register(&rcu);
+	if (slot == -1) {
+		printf("Too many readers, dropping a connection.\n");
+		close(fd);
+		return NULL;
+	}
+	while (net_read(fd, &q, sizeof(q)) == 0) {
+		market_answer(rcu_read_lock(&rcu, slot), &q, &reply);
+		rcu_read_unlock(&rcu, slot);
+		if (net_write(fd, &reply, sizeof(reply))) {
+			break;
+		}
+	}
+	rcu_unregister(&rcu, slot);
+	close(fd);
+	return NULL;
+}
+
+int
+main(int argc, char** argv)
+{
+	struct loader l = { NULL, 10 };
+	pthread_attr_t attr;
+	pthread_t t;
+	int opt, lfd, fd;
+	while ((opt = getopt(argc, argv, "i:")) != -1) {
+		switch(opt) {
+		case 'i':
+			l.interval = (unsigned int)strtoul(optarg, NULL, 10);
+			l.interval = l.interval ? l.interval : 1;
+			break;
+		default:
+			argc = 0;
+			break;
+		}
+	}
+	if (argc - optind != 2) {
+		printf("Usage: %s [-i seconds] store "
+		    "unix:/path|tcp:[host:]port\n", argv[0]);
+		return 1;
+	}
+	l.root = argv[optind];
+	if ((lfd = net_listen(argv[optind + 1])) == -1) {
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN); /* A reader hanging up is its business. */
+	rcu_init(&rcu, NULL);
+	if (pool_init(&pool, 0)) {
+		printf("Failed to start the thread pool.\n");
+		return 1;
+	}
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if (pthread_create(&t, &attr, load, &l)) {
+		printf("Failed to start the loader.\n");
+		return 1;
+	}
+	for (;;) {
+		if ((fd = accept(lfd, NULL, NULL)) == -1) {
+			continue;
+		}
+		if (pthread_create(&t, &attr, serve, (void *)(intptr_t)fd)) {
+			printf("Failed to start a reader.\n");
+			close(fd);
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#include <stdio.h>	/* printf() */
+#include <signal.h>	/* signal() */
+#include <unistd.h>	/* fork() */
+#include <sys/socket.h>	/* accept() */
+
+#include "lib/arena.h"
+#include "lib/cursor.h"
+#include "lib/mem.h"
+#include "lib/net.h"
+
+/*
+ * Usage: pagerd store addr
+ *
+ * Serves the rows queries match, a page at a time, on addr as for shardd.
+ * Each connection sends struct cursor_req records and gets a struct
+ * cursor_reply for each; see pages.c. A connection keeps its last cursor
+ * open, so paging through it reads each row once. A client may also
+ * resume a cursor on another connection, or from another pagerd over the
+ * same store, at the cost of reopening it.
+*/
+
+/* Scratch for one partition's scan, reset between partitions. */
+#define SCRATCH (4UL << 20)
+
+static int
+serve(int fd, const char *root)
+{
+	static struct cursor_reply reply;
+	struct cursor_req req;
+	struct cursor c;
+	struct arena scratch;
+	if (arena_init(&scratch, SCRATCH, MEM_QUERY)) {
+		return 1;
+	}
+	cursor_init(&c, root, &scratch);
+	while (net_read(fd, &req, sizeof(req)) == 0) {
+		cursor_page(&c, &req, &reply);
+		if (net_write(fd, &reply, sizeof(reply))) {
+			break;
+		}
+	}
+	cursor_free(&c);
+	mem_tag_report("pagerd");
+	fflush(stdout);
+	arena_free(&scratch);
+	return 0;
+}
+
+int
+main(int argc, char** argv)
+{
+	int lfd, fd;
+	if (argc != 3) {
+		printf("Usage: %s store unix:/path|tcp:[host:]port\n", argv[0]);
+		return 1;
+	}
+	if ((lfd = net_listen(argv[2])) == -1) {
+		return 1;
+	}
+	signal(SIGCHLD, SIG_IGN); /* Connections exit on their own. */
+	for (;;) {
+		if ((fd = accept(lfd, NULL, NULL)) == -1) {
+			continue;
+		}
+		switch(fork()) {
+		case -1:
+			printf("Failed to fork().\n");
+			break;
+		case 0: /* child */
+			close(lfd);
+			_exit(serve(fd, argv[1]));
+		default: /* parent */
+			break;
+		}
+		close(fd);
+	}
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>	/* printf(), sscanf() */
+#include <stdlib.h>	/* strtoul(), atoi() */
+#include <string.h>	/* memset() */
+#include <unistd.h>	/* getopt(), close() */
+
+#include "lib/cursor.h"
+#include "lib/net.h"
+
+/*
+ * Usage: pages [-t typeID] [-r regionID] [-b 0|1] [-f from] [-u to]
+ *		[-n limit] [-p pages] [-c cursor] addr
+ *
+ * Prints the orders a query matches, paging through them with pagerd on
+ * addr, limit rows (default CURSOR_PAGEMAX) a page: orderID, typeID,
+ * regionID, stationID, bid, price, volRem, volMin, issued, rtime,
+ * duration and range. With -p, stops after that many pages and prints
+ * the cursor to go on from; -c resumes it, with the same filters, on a
+ * new connection.
+*/
+
+#define POS_FMT "%llx:%u:%u:%llu:%u:%llu"
+
+static void
+print_row(const struct cursor_row *r)
+{
+	printf("%llu %u %u %u %u %llu.%02llu %u %u %u %u %u %d\n",
+	    (unsigned long long)r->orderID, r->typeID, r->regionID,
+	    r->stationID, r->bid, (unsigned long long)(r->price / 100),
+	    (unsigned long long)(r->price % 100), r->volRem, r->volMin,
+	    r->issued, r->rtime, r->duration, r->range);
+}
+
+static int
+parse_pos(struct cursor_pos *pos, const char *s)
+{
+	unsigned long long pin, group, returned;
+	memset(pos, 0, sizeof(*pos));
+	if (sscanf(s, POS_FMT, &pin, &pos->nparts, &pos->part, &group,
+	    &pos->row, &returned) != 6 || pin == 0) {
+		return 1;
+	}
+	pos->pin = pin;
+	pos->group = group;
+	pos->returned = returned;
+	return 0;
+}
+
+int
+main(int argc, char** argv)
+{
+	static struct cursor_reply reply;
+	struct cursor_req req;
+	unsigned long pages = 0, n;
+	uint32_t i;
+	int opt, fd;
+	memset(&req, 0, sizeof(req));
+	req.q.bid = -1;
+	req.limit = CURSOR_PAGEMAX;
+	while ((opt = getopt(argc, argv, "t:r:b:f:u:n:p:c:")) != -1) {
+		switch(opt) {
+		case 't':
+			req.q.typeID = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			req.q.regionID = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			req.q.bid = atoi(optarg);
+			break;
+		case 'f':
+			req.q.from = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'u':
+			req.q.to = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			req.limit = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'p':
+			pages = strtoul(optarg, NULL, 10);
+			break;
+		case 'c':
+			if (parse_pos(&req.pos, optarg)) {
+				printf("Bad cursor: %s\n", optarg);
+				return 1;
+			}
+			break;
+		default:
+			argc = 0;
+			break;
+		}
+	}
+	if (argc - optind != 1 || req.limit == 0) {
+		printf("Usage: %s [-t typeID] [-r regionID] [-b 0|1] [-f from] "
+		    "[-u to] [-n limit] [-p pages] [-c cursor] addr\n",
+		    argv[0]);
+		return 1;
+	}
+	if ((fd = net_connect(argv[optind])) == -1) {
+		return 1;
+	}
+	for (n = 0; !req.pos.done && (pages == 0 || n < pages); ++n) {
+		if (net_write(fd, &req, sizeof(req))
+		    || net_read(fd, &reply, sizeof(reply))) {
+			printf("Lost the connection to %s\n", argv[optind]);
+			close(fd);
+			return 1;
+		}
+		if (reply.rc == CURSOR_STALE) {
+			printf("The store changed under the cursor.\n");
+			break;
+		} else if (reply.rc) {
+			printf("Failed to read a page.\n");
+			break;
+		}
+		for (i = 0; i < reply.n; ++i) {
+			print_row(&reply.rows[i]);
+		}
+		req.pos = reply.pos;
+	}
+	close(fd);
+	if (reply.rc) {
+		return 1;
+	}
+	printf("%llu rows in %lu pages", (unsigned long long)req.pos.returned,
+	    n);
+	if (!req.pos.done) {
+		printf(", more with -c " POS_FMT,
+		    (unsigned long long)req.pos.pin, req.pos.nparts,
+		    req.pos.part, (unsigned long long)req.pos.group,
+		    req.pos.row, (unsigned long long)req.pos.returned);
+	}
+	printf("\n");
+	return 0;
+}
@@ -0,0 +1,67 @@
+#include <stdio.h>	/* printf() */
+#include <stdlib.h>	/* malloc(), strtol() */
+#include <string.h>	/* memmove() */
+#include <unistd.h>	/* read() */
+
+#include "lib/zframes.h"
+
+/*
+ * Usage: ( echo ${date}; gunzip -c f.dump.gz ) | repack f.dump.zst [frameMB]
+ *
+ * Repacks converter input (date line, then the dump) into a seekable zstd
+ * archive. Frames hold about frameMB (default 4) of whole lines each, so
+ * the converter can inflate them in parallel and parse them in order.
+*/
+int
+main(int argc, char** argv)
+{
+	#define LEVEL 9
+	size_t frame, use = 0, cut;
+	ssize_t rb;
+	char *buf;
+	FILE *out;
+	struct zframes_writer w;
+	int rc = 0;
+	if (argc < 2) {
+		printf("Usage: %s out.dump.zst [frameMB] < dump\n", argv[0]);
+		return 1;
+	}
+	frame = (size_t)((argc > 2) ? strtol(argv[2], NULL, 10) : 4) << 20;
+	if (frame == 0 || (buf = malloc(frame)) == NULL) {
+		printf("Bad frame size\n");
+		return 1;
+	}
+	if (!(out = fopen(argv[1], "wb"))) {
+		perror(argv[1]);
+		free(buf);
+		return 1;
+	}
+	zframes_writer_init(&w, out, LEVEL);
+	while (!rc && (rb = read(STDIN_FILENO, buf + use, frame - use)) > 0) {
+		use += (size_t)rb;
+		if (use < frame) {
+			continue;
+		}
+		/* Cut after the last complete line; a line longer than a whole
+		 * frame just gets split. */
+		for (cut = use; cut > 0 && buf[cut - 1] != '\n'; --cut) {
+		}
+		cut = cut ? cut : use;
+		rc = zframes_write(&w, buf, cut);
+		memmove(buf, buf + cut, use - cut);
+		use -= cut;
+	}
+	if (rb < 0) {
+		perror("read()");
+		rc = 1;
+	}
+	rc = rc || zframes_write(&w, buf, use);
+	rc = zframes_writer_finish(&w) || rc;
+	rc = (fclose(out) != 0) || rc;
+	free(buf);
+	if (rc) {
+		printf("Failed to write %s\n", argv[1]);
+		remove(argv[1]);
+	}
+	return rc;
+}
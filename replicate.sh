@@ -0,0 +1,110 @@
+#!/bin/sh
+
+# Usage:
+#	replicate.sh src dst...		Bring every replica store dst up to the
+#					store src (see dumper.sh).
+#	replicate.sh -w src dst...	Do that, then keep shipping each segment
+#					as soon as src publishes it.
+#
+# Segments are immutable once published, so replication is log shipping:
+# the replica applies the source MANIFEST in order, copying each segment to
+# a new version directory ${dst}/${date}.v*/, renaming the symlink
+# ${dst}/${date} to it and then appending its date to ${dst}/MANIFEST, the
+# same way dumper.sh publishes. A replica is therefore always a prefix of
+# the source and queries on it never see a half copied segment. A
+# re-ingested source segment is newer than its copy and is shipped again
+# in place, with no moment where the date is missing.
+
+interval=${INTERVAL:-5}
+
+# Copy one segment into a replica and publish it there, as publish() in
+# dumper.sh does: whether to list it is up to the replica's manifest, so a
+# copy that died before its append is listed by the next one.
+ship()
+{
+	src=$1
+	dst=$2
+	date=$3
+	link=${dst}/${date}
+
+	ver=$( mktemp -d ${link}.vXXXXXX ) && chmod 755 ${ver} || return 1
+	if ! cp -R ${src}/${date}/. ${ver}
+	then
+		rm -rf ${ver}
+		return 1
+	fi
+	if [ -d ${link} ] && [ ! -L ${link} ]; then
+		mv ${link} ${link}.v0 || return 1
+		ln -s ${date}.v0 ${link} || return 1
+	fi
+	ln -s ${ver##*/} ${link}.lnk && mv -T ${link}.lnk ${link} || return 1
+	grep -qx ${date} ${dst}/MANIFEST ||
+	    echo ${date} >> ${dst}/MANIFEST || return 1
+	for old in ${link}.v*
+	do
+		[ ${old} = ${ver} ] || rm -rf ${old}
+	done
+}
+
+# Apply the source manifest entries a replica hasn't got yet, then report
+# how far behind it is.
+catchup()
+{
+	src=$1
+	dst=$2
+
+	mkdir -p ${dst} && touch ${dst}/MANIFEST || return 1
+	# Only whole lines; the source may be appending as we read.
+	total=$( wc -l < ${src}/MANIFEST )
+	have=$( wc -l < ${dst}/MANIFEST )
+	# Dictionaries (see lib/dict.h) only grow, so copies taken after
+	# reading the manifest cover every segment it lists.
+	for dict in ${src}/DICT.*
+	do
+		# Not the lock, nor a save in flight (see lib/dict.c).
+		case ${dict} in
+		*.tmp|*.lock)
+			continue
+			;;
+		esac
+		[ -f ${dict} ] || continue
+		name=${dict##*/}
+		cp ${dict} ${dst}/${name}.tmp && mv ${dst}/${name}.tmp \
+		    ${dst}/${name} || return 1
+	done
+	n=0
+	for date in $( head -n ${total} ${src}/MANIFEST )
+	do
+		n=$(( n + 1 ))
+		if [ ${n} -gt ${have} ] || [ ${src}/${date} -nt ${dst}/${date} ]
+		then
+			ship ${src} ${dst} ${date} || break
+			echo "Shipped - ${date} to ${dst}"
+		fi
+	done
+	have=$( wc -l < ${dst}/MANIFEST )
+	echo "Lag - ${dst} $(( total - have )) segments"
+}
+
+if [ "$1" = "-w" ]; then
+	watch=1
+	shift
+fi
+if [ $# -lt 2 ]; then
+	echo "Usage: $0 [-w] src dst..."
+	exit 1
+fi
+src=$1
+shift
+
+while :
+do
+	for dst in "$@"
+	do
+		catchup ${src} ${dst}
+	done
+	if [ -z "${watch}" ]; then
+		break
+	fi
+	sleep ${interval}
+done
@@ -0,0 +1,117 @@
+#include <stdio.h>	/* printf() */
+#include <stdlib.h>	/* strtoul() */
+#include <unistd.h>	/* getopt(), sleep() */
+#include <time.h>	/* clock_gettime() */
+
+#include "lib/arena.h"
+#include "lib/checksum.h"
+#include "lib/cpu.h"
+#include "lib/scan.h"
+#include "lib/store.h"
+
+/*
+ * Usage: scrub [-b] [-i seconds] store
+ *
+ * Checks every row group of every partition of the store against its
+ * checksums (see lib/checksum.h), and prints each one that doesn't match,
+ * then how much it read and how fast. Nothing is decompressed or parsed,
+ * so it goes as fast as the disk does.
+ *
+ * Partitions without checksums, from before the converter wrote them, are
+ * reported; -b checksums them instead, trusting what is on disk now.
+ * Checksums that are corrupt, or stale (the columns changed length since),
+ * count as corruption and are never rebuilt. With -i, scrubs again every
+ * so many seconds, picking up new segments, so silent corruption shows up
+ * within one interval. Exits 1 if anything is corrupt (without -i).
+*/
+
+/* Scrubs the store once. Returns 0 if everything checked out. */
+static int
+scrub(const char *root, int backfill, struct arena *a)
+{
+	struct store s;
+	struct scrub_stats st = { 0, 0, 0 };
+	struct timespec t0, t1;
+	unsigned int i, unchecked = 0, untrusted = 0;
+	double secs;
+	int rc = 0;
+	if (store_open(&s, root)) {
+		return 1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < s.nparts; ++i) {
+		const struct partition *p = &s.parts[i];
+		struct checksums c;
+		/* A buffer and two sets of checksums. */
+		if (arena_init(a, (4UL << 20) + 2 * NCOLS * (scan_ngroups(p)
+		    + 1) * sizeof(uint32_t) + 4096, MEM_INDEX)) {
+			rc = 1;
+			break;
+		}
+		switch (checksum_load(&c, p, a)) {
+		case CHECKSUM_OK:
+			arena_reset(a);
+			rc |= checksum_scrub(p, &st, a);
+			break;
+		case CHECKSUM_MISSING:
+			if (backfill && checksum_collect(p->dir) == 0) {
+				printf("Checksummed %s\n", p->dir);
+				break;
+			}
+			printf("No checksums in %s\n", p->dir);
+			unchecked++;
+			break;
+		default: /* Reported by checksum_load(). */
+			untrusted++;
+			rc = 1;
+			break;
+		}
+		arena_free(a);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	store_free(&s);
+	secs = (double)(t1.tv_sec - t0.tv_sec)
+	    + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+	printf("%.1f MB in %.2f s, %.0f MB/s: %llu row groups, %llu bad, "
+	    "%u partitions unchecked, %u with bad checksums\n",
+	    (double)st.bytes / 1e6, secs,
+	    (double)st.bytes / 1e6 / (secs > 0 ? secs : 1),
+	    (unsigned long long)st.groups, (unsigned long long)st.bad,
+	    unchecked, untrusted);
+	fflush(stdout);
+	return rc;
+}
+
+int
+main(int argc, char** argv)
+{
+	unsigned int interval = 0;
+	int opt, backfill = 0;
+	struct arena a;
+	while ((opt = getopt(argc, argv, "bi:")) != -1) {
+		switch(opt) {
+		case 'b':
+			backfill = 1;
+			break;
+		case 'i':
+			interval = (unsigned int)strtoul(optarg, NULL, 10);
+			interval = interval ? interval : 1;
+			break;
+		default:
+			argc = 0;
+			break;
+		}
+	}
+	if (argc - optind != 1) {
+		printf("Usage: %s [-b] [-i seconds] store\n", argv[0]);
+		return 1;
+	}
+	printf("CPU level: %s\n", cpu_level_name(cpu_init()));
+	if (interval == 0) {
+		return scrub(argv[optind], backfill, &a);
+	}
+	for (;;) {
+		scrub(argv[optind], backfill, &a);
+		sleep(interval);
+	}
+}
@@ -0,0 +1,93 @@
+#include <stdio.h>	/* printf() */
+#include <stdint.h>	/* intptr_t */
+#include <signal.h>	/* signal() */
+#include <unistd.h>	/* close() */
+#include <pthread.h>	/* pthread_create() */
+#include <sys/socket.h>	/* accept() */
+
+#include "lib/mem.h"
+#include "lib/net.h"
+#include "lib/pool.h"
+#include "lib/query.h"
+#include "lib/store.h"
+
+/*
+ * Usage: shardd store addr
+ *
+ * Serves queries over one store (see dumper.sh) on addr, "unix:/path" or
+ * "tcp:[host:]port". Each connection sends struct query records and gets
+ * a struct query_reply for each; see coord.c. The manifest is re-read per
+ * query, so newly published segments show up without a restart.
+ * Connections are threads, and run their queries on one pool (EVE_THREADS
+ * workers, see lib/pool.h), a partition per task, however many there are.
+*/
+
+/* Scratch for one partition's scan, per worker, reset between partitions. */
+#define SCRATCH (4UL << 20)
+
+static const char *root;
+static struct pool pool;
+static struct arena *scratch;	/* Per worker, see query_scratch(). */
+
+static void *
+serve(void *arg)
+{
+	const int fd = (int)(intptr_t)arg;
+	struct query q;
+	struct query_reply reply;
+	struct store store;
+	while (net_read(fd, &q, sizeof(q)) == 0) {
+		partial_init(&reply.result);
+		reply.pad = 0;
+		if (q.topk > QUERY_TOPK) {
+			q.topk = QUERY_TOPK;
+		}
+		reply.rc = store_open(&store, root);
+		if (reply.rc == 0) {
+			reply.rc = query_run_pool(&store, &q, &reply.result,
+			    &pool, scratch);
+			store_free(&store);
+		}
+		fflush(stdout); /* Plans, for QUERY_EXPLAIN. */
+		if (net_write(fd, &reply, sizeof(reply))) {
+			break;
+		}
+	}
+	mem_tag_report("shardd");
+	fflush(stdout);
+	close(fd);
+	return NULL;
+}
+
+int
+main(int argc, char** argv)
+{
+	pthread_attr_t attr;
+	pthread_t t;
+	int lfd, fd;
+	if (argc != 3) {
+		printf("Usage: %s store unix:/path|tcp:[host:]port\n", argv[0]);
+		return 1;
+	}
+	root = argv[1];
+	if ((lfd = net_listen(argv[2])) == -1) {
+		return 1;
+	}
+	if (pool_init(&pool, 0)
+	    || (scratch = query_scratch(&pool, SCRATCH)) == NULL) {
+		printf("Failed to start the thread pool.\n");
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN); /* A client hanging up is its business. */
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	for (;;) {
+		if ((fd = accept(lfd, NULL, NULL)) == -1) {
+			continue;
+		}
+		if (pthread_create(&t, &attr, serve, (void *)(intptr_t)fd)) {
+			printf("Failed to start a connection.\n");
+			close(fd);
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#include <stdio.h>	/* printf() */
+
+#include "lib/arena.h"
+#include "lib/stats.h"
+#include "lib/store.h"
+
+/*
+ * Usage: stats store
+ *
+ * Collects the planner's stats (see lib/stats.h) for every partition of
+ * the store that has none, or stale ones, as for stores written before
+ * the converter collected them. Then prints each partition's summary.
+*/
+
+static void
+print_stats(const struct partition *p, const struct stats *st)
+{
+	static const char *const names[NSTATS] = {
+		"typeid", "regionid", "price", "rtime"
+	};
+	int c;
+	printf("%s rows %llu groups %llu\n", p->dir,
+	    (unsigned long long)st->rows, (unsigned long long)st->ngroups);
+	for (c = 0; c < NSTATS; ++c) {
+		printf("\t%-8s min %llu max %llu distinct %.0f\n", names[c],
+		    (unsigned long long)st->col[c].min,
+		    (unsigned long long)st->col[c].max,
+		    hll_count(&st->col[c].ndv));
+	}
+	return;
+}
+
+int
+main(int argc, char** argv)
+{
+	struct store s;
+	struct stats st;
+	struct arena a;
+	unsigned int i;
+	int rc = 0;
+	if (argc != 2) {
+		printf("Usage: %s store\n", argv[0]);
+		return 1;
+	}
+	if (store_open(&s, argv[1]) || arena_init(&a, 1UL << 20, MEM_INDEX)) {
+		return 1;
+	}
+	for (i = 0; i < s.nparts && rc == 0; ++i) {
+		arena_reset(&a);
+		if (stats_load(&st, &s.parts[i], &a) == 0) {
+			print_stats(&s.parts[i], &st);
+			continue;
+		}
+		arena_reset(&a);
+		if (stats_collect(s.parts[i].dir)
+		    || stats_load(&st, &s.parts[i], &a)) {
+			rc = 1;
+		} else {
+			print_stats(&s.parts[i], &st);
+		}
+	}
+	arena_free(&a);
+	store_free(&s);
+	return rc;
+}
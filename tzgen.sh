@@ -0,0 +1,99 @@
+#!/bin/sh
+
+# Usage:
+#	tzgen.sh > lib/tztab.c
+#
+# Generates the time zone table of lib/tz.h from the system's tzdata with
+# zdump(8): every UTC offset of ${ZONES} between ${FROM} and ${TO}, keyed
+# by the first local time it applies to in the parser's calendar (see
+# ejday() in lib/eve_parser.c). Times from the start of ${TO} on are past
+# the table, and lib/tz.c rejects them rather than guess. Rerun it when
+# tzdata changes, a feed from another zone shows up or ${TO} gets close,
+# and commit the result.
+
+ZONES=${ZONES:-"America/Los_Angeles America/New_York Atlantic/Reykjavik
+    Europe/London Europe/Berlin Europe/Moscow Asia/Shanghai UTC"}
+FROM=${FROM:-2003}
+TO=${TO:-2037}
+tzdir=${TZDIR:-/usr/share/zoneinfo}
+
+version=$( sed -n 's/^# version //p' ${tzdir}/tzdata.zi 2>/dev/null )
+
+# The C name of a zone's arrays.
+cname()
+{
+	echo $1 | tr 'A-Z/+-' 'a-z___'
+}
+
+# The zone's offset to UTC at the start of ${FROM}, in case nothing changes.
+base()
+{
+	TZ=$1 date -d "${FROM}-01-01 12:00" +%z |
+	awk '{ s = substr($1, 1, 1) == "-" ? -1 : 1;
+	    print -s * (substr($1, 2, 2) * 3600 + substr($1, 4, 2) * 60) }'
+}
+
+# Lines of zdump -v come in pairs around each transition; the second one
+# has the new local time and offset.
+table()
+{
+	zone=$1
+	zdump -v -c ${FROM},${TO} ${zone} | grep -v NULL |
+	awk -v name=$( cname ${zone} ) -v base=$( base ${zone} ) '
+	function ejday(y, m, d) {
+		return (y * 365 + int(y / 4) - int(y / 100) + int(y / 400) \
+		    + int((m * 306 + 5) / 10) + d - 1 - 719558) * 86400
+	}
+	function emit(type, what, first, arr) {
+		printf("static const %s %s_%s[] = {\n\t%d,", type, name, what,
+		    first)
+		for (i = 1; i <= n; i++) {
+			printf("%s%d,", (i % 6 == 0) ? "\n\t" : " ", arr[i])
+		}
+		printf("\n};\n")
+	}
+	BEGIN {
+		split("Jan Feb Mar Apr May Jun Jul Aug Sep Oct Nov Dec", mn)
+		for (i = 1; i <= 12; i++) {
+			mon[mn[i]] = i
+		}
+		n = 0
+	}
+	NR % 2 == 1 && n == 0 {
+		sub("gmtoff=", "", $16)
+		base = -$16
+	}
+	NR % 2 == 0 {
+		split($12, t, ":")
+		at[++n] = ejday($13, mon[$10], $11) \
+		    + t[1] * 3600 + t[2] * 60 + t[3]
+		sub("gmtoff=", "", $16)
+		off[n] = -$16
+	}
+	END {
+		emit("uint32_t", "at", 0, at)
+		emit("int32_t", "off", base, off)
+		printf("\n")
+	}'
+}
+
+echo "/* Generated by tzgen.sh from tzdata ${version:-?}, ${FROM} to ${TO}. */"
+echo
+echo "#include \"tz.h\""
+echo
+for zone in ${ZONES}; do
+	table ${zone} || exit 1
+done
+end=$( awk -v y=${TO} 'BEGIN { printf("%.0f", (y * 365 + int(y / 4) \
+    - int(y / 100) + int(y / 400) + int((306 + 5) / 10) - 719558) * 86400) }' )
+echo "#define ZONE(zone, c) { zone, sizeof(c##_at) / sizeof(c##_at[0]), \\"
+echo "	${end}U, c##_at, c##_off }"
+echo
+echo "const struct tz_zone tz_zones[] = {"
+for zone in ${ZONES}; do
+	echo "	ZONE(\"${zone}\", $( cname ${zone} )),"
+done
+echo "};"
+echo
+echo "const unsigned int tz_nzones = sizeof(tz_zones) / sizeof(tz_zones[0]);"
+echo "const unsigned int tz_endyear = ${TO};"